@@ -46,6 +46,7 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "fstream"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
 
 #include "llvm/Support/FileSystem.h"
 #include "llvm/IR/Module.h"
@@ -75,6 +76,96 @@ namespace
 
 char AFLCoverage::ID = 0;
 
+/* Indirect call profiling (AFL_ICALL_PROFILE, see README.llvm). Every
+   indirect call site stores its name in __afl_icall_site right before the
+   call, and the entry of every address-taken function hands its own name to
+   the runtime, which pairs the two. Sites are numbered per function in the
+   same way impact_analysis numbers them in the bitcode written above. */
+
+static void instrumentIndirectCalls(Module &M, const std::string &bcName,
+                                    char be_quiet)
+{
+
+  LLVMContext &C = M.getContext();
+  PointerType *Int8PtrTy = PointerType::getUnqual(IntegerType::getInt8Ty(C));
+
+  GlobalVariable *AFLICallSite = new GlobalVariable(
+      M, Int8PtrTy, false, GlobalValue::ExternalLinkage, 0, "__afl_icall_site",
+      0, GlobalVariable::GeneralDynamicTLSModel, 0, false);
+
+  FunctionCallee TraceTarget = M.getOrInsertFunction(
+      "__afl_trace_icall_target", Type::getVoidTy(C), Int8PtrTy);
+
+  Constant *NoSite = ConstantPointerNull::get(Int8PtrTy);
+  unsigned site_cnt = 0, target_cnt = 0;
+
+  for (auto &F : M)
+  {
+
+    if (F.isDeclaration())
+      continue;
+
+    std::vector<CallBase *> ICalls;
+
+    for (auto &I : instructions(F))
+    {
+      auto *CB = dyn_cast<CallBase>(&I);
+      if (CB && !CB->isInlineAsm() &&
+          !isa<Function>(CB->getCalledOperand()->stripPointerCasts()))
+        ICalls.push_back(CB);
+    }
+
+    for (unsigned i = 0; i < ICalls.size(); i++)
+    {
+
+      IRBuilder<> IRB(ICalls[i]);
+      std::string SiteName = bcName + ":" + F.getName().str() + ":" + std::to_string(i);
+      IRB.CreateStore(IRB.CreateGlobalStringPtr(SiteName), AFLICallSite);
+
+      /* Clear the site once the call returns, so that a callback from an
+         uninstrumented callee is not attributed to it. */
+
+      if (isa<CallInst>(ICalls[i]))
+      {
+        IRB.SetInsertPoint(ICalls[i]->getNextNode());
+        IRB.CreateStore(NoSite, AFLICallSite);
+      }
+
+      /* An invoke ends its block, so clear it where control resumes: at the
+         start of the normal destination, and after the landingpad when the
+         callee throws. Other predecessors of these blocks only see a store
+         of the value that is already there. */
+
+      if (auto *II = dyn_cast<InvokeInst>(ICalls[i]))
+      {
+        for (BasicBlock *Dest : {II->getNormalDest(), II->getUnwindDest()})
+        {
+          BasicBlock::iterator IP = Dest->getFirstInsertionPt();
+          if (IP == Dest->end())
+            continue;
+          IRB.SetInsertPoint(&*IP);
+          IRB.CreateStore(NoSite, AFLICallSite);
+        }
+      }
+
+      site_cnt++;
+    }
+
+    if (F.hasAddressTaken())
+    {
+
+      IRBuilder<> IRB(&*F.getEntryBlock().getFirstInsertionPt());
+      std::string TargetName = bcName + ":" + F.getName().str();
+      IRB.CreateCall(TraceTarget, {IRB.CreateGlobalStringPtr(TargetName)});
+      target_cnt++;
+    }
+  }
+
+  if (!be_quiet)
+    OKF("Profiling %u indirect call sites and %u possible targets.", site_cnt,
+        target_cnt);
+}
+
 bool AFLCoverage::runOnModule(Module &M)
 {
 
@@ -151,6 +242,12 @@ bool AFLCoverage::runOnModule(Module &M)
     errs() << "Error: " << EC2.message() << "\n";
   }
 
+  // 间接调用记录的插桩放在输出 .bc/.ll 之后，分析用的 bitcode 不含插桩代码
+  if (getenv("AFL_ICALL_PROFILE"))
+  {
+    instrumentIndirectCalls(M, fileName + ".bc", be_quiet);
+  }
+
   return true;
 
   return true; // Indicates that the module was not modified
@@ -36,6 +36,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
 
 #include <sys/mman.h>
 #include <sys/shm.h>
@@ -68,6 +70,20 @@ __thread u32 __afl_prev_loc;
 static u8 is_persistent;
 
 
+/* Indirect call profiling (AFL_ICALL_PROFILE). The coverage map above only
+   keeps hashed edge counts, so the observed (call site, target) pairs are
+   kept in a table of their own, keyed by the addresses of the name strings
+   emitted by the pass, and appended to the file named by AFL_ICALL_PROFILE
+   when the process exits. */
+
+#define ICALL_TABLE_SIZE (1 << 16)
+
+__thread const char* __afl_icall_site;
+
+static const char* icall_sites[ICALL_TABLE_SIZE];
+static const char* icall_targets[ICALL_TABLE_SIZE];
+
+
 /* SHM setup. */
 
 static void __afl_map_shm(void) {
@@ -252,12 +268,84 @@ void __afl_manual_init(void) {
 }
 
 
+/* Called on entry to every address-taken function of an instrumented module.
+   Pairs the function with the indirect call site that was just left, if any.
+   Slots are claimed with a CAS; a pair that races with its own insertion may
+   be stored twice, which the profile loader folds again. */
+
+void __afl_trace_icall_target(const char* target) {
+
+  const char* site = __afl_icall_site;
+  u32 idx, probe;
+
+  if (!site) return;
+  __afl_icall_site = NULL;
+
+  idx = (u32)((((uintptr_t)site >> 3) * 0x9E3779B1u) ^ ((uintptr_t)target >> 3));
+
+  for (probe = 0; probe < ICALL_TABLE_SIZE; probe++) {
+
+    u32 slot = (idx + probe) & (ICALL_TABLE_SIZE - 1);
+
+    if (icall_sites[slot] == site && icall_targets[slot] == target) return;
+
+    if (!icall_sites[slot] &&
+        __sync_bool_compare_and_swap(&icall_sites[slot], NULL, site)) {
+
+      icall_targets[slot] = target;
+      return;
+
+    }
+
+  }
+
+  /* Table full: the remaining pairs are dropped. */
+
+}
+
+
+/* Append the recorded pairs as "site<TAB>target" lines. Every line goes out in
+   a single write() so that concurrent processes (e.g. forkserver children)
+   do not interleave within a line. */
+
+static void __afl_dump_icall_profile(void) {
+
+  u8* path = getenv("AFL_ICALL_PROFILE");
+  char line[4096];
+  u32 i;
+  s32 fd;
+
+  if (!path) return;
+
+  fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+  if (fd < 0) return;
+
+  for (i = 0; i < ICALL_TABLE_SIZE; i++) {
+
+    int len;
+
+    if (!icall_sites[i] || !icall_targets[i]) continue;
+
+    len = snprintf(line, sizeof(line), "%s\t%s\n", icall_sites[i], icall_targets[i]);
+    if (len > 0 && len < (int)sizeof(line)) {
+      if (write(fd, line, len) != len) break;
+    }
+
+  }
+
+  close(fd);
+
+}
+
+
 /* Proper initialization routine. */
 
 __attribute__((constructor(CONST_PRIO))) void __afl_auto_init(void) {
 
   is_persistent = !!getenv(PERSIST_ENV_VAR);
 
+  if (getenv("AFL_ICALL_PROFILE")) atexit(__afl_dump_icall_profile);
+
   if (getenv(DEFER_ENV_VAR)) return;
 
   __afl_manual_init();
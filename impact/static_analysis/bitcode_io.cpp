@@ -0,0 +1,83 @@
+#include "bitcode_io.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+long getMajorPageFaults()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    return usage.ru_majflt;
+}
+
+void prefetchBitcodeFiles(const std::vector<std::string> &paths, BitcodeIOStats &stats)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats.majorFaultsStart = getMajorPageFaults();
+    for (auto &path : paths)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        ::close(fd);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats.readaheadSeconds += elapsed.count();
+}
+
+llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> openBitcodeFile(const std::string &path, bool isVolatile, BitcodeIOStats &stats)
+{
+    auto start = std::chrono::steady_clock::now();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::error_code(errno, std::generic_category());
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        std::error_code ec(errno, std::generic_category());
+        ::close(fd);
+        return ec;
+    }
+    // 位码读取器不需要结尾的 '\0'，这样 LLVM 对足够大的文件总是使用 mmap；映射在关闭 fd 后仍然有效
+    auto buffer = llvm::MemoryBuffer::getOpenFile(fd, path, st.st_size, /*RequiresNullTerminator=*/false, isVolatile);
+    ::close(fd);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    stats.openNanoseconds += (uint64_t)elapsed.count();
+    if (buffer)
+    {
+        stats.files++;
+        if ((*buffer)->getBufferKind() == llvm::MemoryBuffer::MemoryBuffer_MMap)
+        {
+            stats.mappedBytes += (*buffer)->getBufferSize();
+        }
+        else
+        {
+            stats.copiedBytes += (*buffer)->getBufferSize();
+        }
+    }
+    return buffer;
+}
+
+void printBitcodeIOStats(const BitcodeIOStats &stats)
+{
+    double mb = 1024.0 * 1024.0;
+    llvm::errs() << "Bitcode I/O: " << stats.files << " files, "
+                 << llvm::format("%.2f", (stats.mappedBytes + stats.copiedBytes) / mb) << " MB ("
+                 << llvm::format("%.2f", stats.mappedBytes / mb) << " MB mapped), readahead "
+                 << llvm::format("%.3f", stats.readaheadSeconds) << " s, open/read "
+                 << llvm::format("%.3f", stats.openNanoseconds / 1e9) << " s, major page faults "
+                 << getMajorPageFaults() - stats.majorFaultsStart << "\n";
+}
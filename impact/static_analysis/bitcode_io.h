@@ -0,0 +1,30 @@
+#ifndef BITCODE_IO_H
+#define BITCODE_IO_H
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ErrorOr.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// 读取 .bc 文件的统计信息，加载线程并发更新
+struct BitcodeIOStats
+{
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> mappedBytes{0};
+    std::atomic<uint64_t> copiedBytes{0};
+    std::atomic<uint64_t> openNanoseconds{0}; // open/fstat/mmap（不映射时包含 read）所花的时间
+    double readaheadSeconds = 0;
+    long majorFaultsStart = 0;
+};
+
+// 对所有文件发出 POSIX_FADV_WILLNEED，让内核在解析前面的文件时提前读入后面的文件
+void prefetchBitcodeFiles(const std::vector<std::string> &paths, BitcodeIOStats &stats);
+// 以 mmap 方式打开 .bc 文件，不复制内容；isVolatile 为 true 时改为读入内存，
+// 用于文件可能在模块仍在使用时被原地改写的情况
+llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> openBitcodeFile(const std::string &path, bool isVolatile, BitcodeIOStats &stats);
+void printBitcodeIOStats(const BitcodeIOStats &stats);
+long getMajorPageFaults();
+
+#endif
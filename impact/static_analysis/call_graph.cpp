@@ -0,0 +1,268 @@
+#include "call_graph.h"
+
+CallGraphIndex::CallGraphIndex(IA &ia) : ia(ia)
+{
+}
+
+void CallGraphIndex::build()
+{
+    exact = !ia.isLazyLoad();
+    size_t n = ia.getFunctionCount();
+    // 邻接表（CSR）：被调函数 -> 调用者
+    std::vector<unsigned> offsets(n + 1, 0);
+    std::vector<unsigned> targets;
+    std::vector<Function *> callers;
+    for (unsigned id = 0; id < n; id++)
+    {
+        offsets[id] = targets.size();
+        Function *function = ia.getFunctionById(id);
+        if (!function)
+        {
+            continue;
+        }
+        ia.getCallerFunctions(function, callers);
+        for (Function *caller : callers)
+        {
+            unsigned callerId = ia.getFunctionId(caller);
+            if (callerId < n)
+            {
+                targets.push_back(callerId);
+            }
+        }
+    }
+    offsets[n] = targets.size();
+    computeSCCs(offsets, targets);
+    condense(offsets, targets);
+    computeLabels();
+    visitMarks.assign(getSCCCount(), 0);
+    visitEpoch = 0;
+}
+
+// 非递归的 Tarjan 算法，分量按完成的先后编号
+void CallGraphIndex::computeSCCs(const std::vector<unsigned> &offsets, const std::vector<unsigned> &targets)
+{
+    const unsigned unvisited = ~0u;
+    size_t n = offsets.size() - 1;
+    std::vector<unsigned> order(n, unvisited);
+    std::vector<unsigned> lowlinks(n);
+    std::vector<char> onStack(n, 0);
+    std::vector<unsigned> stack;
+    std::vector<std::pair<unsigned, unsigned>> dfs; // (节点, 下一条边的位置)
+    unsigned counter = 0;
+    sccIds.assign(n, noSCC);
+    members.clear();
+    memberOffsets.assign(1, 0);
+    for (unsigned root = 0; root < n; root++)
+    {
+        if (order[root] != unvisited)
+        {
+            continue;
+        }
+        order[root] = lowlinks[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        dfs.emplace_back(root, offsets[root]);
+        while (!dfs.empty())
+        {
+            unsigned node = dfs.back().first;
+            if (dfs.back().second < offsets[node + 1])
+            {
+                unsigned target = targets[dfs.back().second++];
+                if (order[target] == unvisited)
+                {
+                    order[target] = lowlinks[target] = counter++;
+                    stack.push_back(target);
+                    onStack[target] = 1;
+                    dfs.emplace_back(target, offsets[target]);
+                }
+                else if (onStack[target])
+                {
+                    lowlinks[node] = std::min(lowlinks[node], order[target]);
+                }
+                continue;
+            }
+            dfs.pop_back();
+            if (!dfs.empty())
+            {
+                unsigned parent = dfs.back().first;
+                lowlinks[parent] = std::min(lowlinks[parent], lowlinks[node]);
+            }
+            if (lowlinks[node] != order[node])
+            {
+                continue;
+            }
+            unsigned scc = memberOffsets.size() - 1;
+            unsigned member;
+            do
+            {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = 0;
+                sccIds[member] = scc;
+                members.push_back(member);
+            } while (member != node);
+            memberOffsets.push_back(members.size());
+        }
+    }
+}
+
+void CallGraphIndex::condense(const std::vector<unsigned> &offsets, const std::vector<unsigned> &targets)
+{
+    size_t sccCount = getSCCCount();
+    edgeOffsets.assign(sccCount + 1, 0);
+    edges.clear();
+    std::vector<unsigned> lastSource(sccCount, noSCC);
+    for (unsigned scc = 0; scc < sccCount; scc++)
+    {
+        edgeOffsets[scc] = edges.size();
+        for (unsigned i = memberOffsets[scc]; i < memberOffsets[scc + 1]; i++)
+        {
+            unsigned member = members[i];
+            for (unsigned e = offsets[member]; e < offsets[member + 1]; e++)
+            {
+                unsigned target = sccIds[targets[e]];
+                if (target != scc && lastSource[target] != scc)
+                {
+                    lastSource[target] = scc;
+                    edges.push_back(target);
+                }
+            }
+        }
+    }
+    edgeOffsets[sccCount] = edges.size();
+}
+
+// 每组标签做一次后序 DFS，两组的子节点顺序相反：post 为后序编号，low 为可达分量中最小的 post
+// u 能到达 v 时 v 的区间一定包含在 u 的区间内，反之不一定
+void CallGraphIndex::computeLabels()
+{
+    size_t sccCount = getSCCCount();
+    std::vector<std::pair<unsigned, unsigned>> dfs;
+    for (unsigned k = 0; k < labelCount; k++)
+    {
+        std::vector<unsigned> &low = lows[k];
+        std::vector<unsigned> &post = posts[k];
+        low.assign(sccCount, 0);
+        post.assign(sccCount, 0);
+        std::vector<char> visited(sccCount, 0);
+        unsigned counter = 0;
+        // 可达的分量编号更小，从编号大的分量开始，DFS 的根大多是没有调用者的函数
+        for (unsigned root = sccCount; root-- > 0;)
+        {
+            if (visited[root])
+            {
+                continue;
+            }
+            visited[root] = 1;
+            dfs.emplace_back(root, 0);
+            while (!dfs.empty())
+            {
+                unsigned node = dfs.back().first;
+                unsigned degree = edgeOffsets[node + 1] - edgeOffsets[node];
+                if (dfs.back().second < degree)
+                {
+                    unsigned i = dfs.back().second++;
+                    unsigned child = edges[edgeOffsets[node] + (k == 0 ? i : degree - 1 - i)];
+                    if (!visited[child])
+                    {
+                        visited[child] = 1;
+                        dfs.emplace_back(child, 0);
+                    }
+                    continue;
+                }
+                dfs.pop_back();
+                post[node] = counter++;
+                low[node] = post[node];
+                for (unsigned e = edgeOffsets[node]; e < edgeOffsets[node + 1]; e++)
+                {
+                    low[node] = std::min(low[node], low[edges[e]]);
+                }
+            }
+        }
+    }
+}
+
+// false 时一定不可达；true 时还需要搜索确认
+bool CallGraphIndex::mayReach(unsigned from, unsigned to) const
+{
+    if (to > from)
+    {
+        return false;
+    }
+    for (unsigned k = 0; k < labelCount; k++)
+    {
+        if (lows[k][to] < lows[k][from] || posts[k][to] > posts[k][from])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 改动 fromFunction 是否可能影响到 toFunction（沿调用链向上）
+bool CallGraphIndex::reaches(unsigned fromFunction, unsigned toFunction)
+{
+    unsigned from = getSCC(fromFunction);
+    unsigned to = getSCC(toFunction);
+    if (from == noSCC || to == noSCC)
+    {
+        return false;
+    }
+    if (from == to)
+    {
+        return true;
+    }
+    if (!mayReach(from, to))
+    {
+        return false;
+    }
+    if (++visitEpoch == 0)
+    {
+        std::fill(visitMarks.begin(), visitMarks.end(), 0);
+        visitEpoch = 1;
+    }
+    std::vector<unsigned> stack = {from};
+    visitMarks[from] = visitEpoch;
+    while (!stack.empty())
+    {
+        unsigned node = stack.back();
+        stack.pop_back();
+        for (unsigned e = edgeOffsets[node]; e < edgeOffsets[node + 1]; e++)
+        {
+            unsigned child = edges[e];
+            if (child == to)
+            {
+                return true;
+            }
+            if (visitMarks[child] != visitEpoch && mayReach(child, to))
+            {
+                visitMarks[child] = visitEpoch;
+                stack.push_back(child);
+            }
+        }
+    }
+    return false;
+}
+
+std::vector<unsigned> CallGraphIndex::markReachable(unsigned scc, std::vector<char> &visited) const
+{
+    std::vector<unsigned> reached;
+    if (visited[scc])
+    {
+        return reached;
+    }
+    visited[scc] = 1;
+    reached.push_back(scc);
+    for (size_t i = 0; i < reached.size(); i++)
+    {
+        for (unsigned e = edgeOffsets[reached[i]]; e < edgeOffsets[reached[i] + 1]; e++)
+        {
+            if (!visited[edges[e]])
+            {
+                visited[edges[e]] = 1;
+                reached.push_back(edges[e]);
+            }
+        }
+    }
+    return reached;
+}
@@ -0,0 +1,61 @@
+#ifndef CALL_GRAPH_H
+#define CALL_GRAPH_H
+
+#include "module_parse.h"
+
+#include <vector>
+
+// 缩点后的调用图：边从被调函数指向调用者，即改动的影响沿调用链向上传播的方向
+// 强连通分量用 Tarjan 算法求出，编号即逆拓扑序：一个分量能到达的分量编号都比它小
+// 可达性查询先用 GRAIL 区间标签排除，标签无法排除时再做带剪枝的 DFS
+// 非懒加载时由已解析的调用关系构建，是精确的；懒加载时由函数摘要构建，可能偏多
+class CallGraphIndex
+{
+public:
+    explicit CallGraphIndex(IA &ia);
+    void build();
+    bool isExact() const
+    {
+        return exact;
+    }
+    size_t getSCCCount() const
+    {
+        return memberOffsets.empty() ? 0 : memberOffsets.size() - 1;
+    }
+    // 函数（规范 ID）所在的分量，构建之后新出现的函数返回 noSCC
+    unsigned getSCC(unsigned functionId) const
+    {
+        return functionId < sccIds.size() ? sccIds[functionId] : noSCC;
+    }
+    std::pair<const unsigned *, const unsigned *> getSCCMembers(unsigned scc) const
+    {
+        return {members.data() + memberOffsets[scc], members.data() + memberOffsets[scc + 1]};
+    }
+    bool reaches(unsigned fromFunction, unsigned toFunction);
+    // 从 scc 出发可达且 visited 中尚未标记的分量（包括 scc 自身），返回前将它们标记
+    std::vector<unsigned> markReachable(unsigned scc, std::vector<char> &visited) const;
+
+    static constexpr unsigned noSCC = ~0u;
+
+private:
+    static constexpr unsigned labelCount = 2;
+
+    IA &ia;
+    bool exact = false;
+    std::vector<unsigned> sccIds;
+    std::vector<unsigned> memberOffsets; // 分量 -> 函数 ID（CSR）
+    std::vector<unsigned> members;
+    std::vector<unsigned> edgeOffsets; // 缩点后的 DAG（CSR），已去重
+    std::vector<unsigned> edges;
+    std::vector<unsigned> lows[labelCount]; // GRAIL 标签 [low, post]
+    std::vector<unsigned> posts[labelCount];
+    std::vector<unsigned> visitMarks; // reaches 中 DFS 的访问标记，按 visitEpoch 区分各次查询
+    unsigned visitEpoch = 0;
+
+    void computeSCCs(const std::vector<unsigned> &offsets, const std::vector<unsigned> &targets);
+    void condense(const std::vector<unsigned> &offsets, const std::vector<unsigned> &targets);
+    void computeLabels();
+    bool mayReach(unsigned from, unsigned to) const;
+};
+
+#endif
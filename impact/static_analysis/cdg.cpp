@@ -0,0 +1,40 @@
+#include "cdg.h"
+
+#include "llvm/Analysis/PostDominators.h"
+
+#include <algorithm>
+
+void collectControlDependences(Function &function, ControlDependences &dependences)
+{
+    dependences.clear();
+    PostDominatorTree postDominators(function);
+    for (auto &block : function)
+    {
+        Instruction *terminator = block.getTerminator();
+        if (!terminator || !(isa<BranchInst>(terminator) || isa<SwitchInst>(terminator)))
+        {
+            continue;
+        }
+        // 无条件跳转的唯一后继一定后支配当前基本块，沿后支配树向上不会经过任何基本块，没有控制依赖
+        auto *branch = dyn_cast<BranchInst>(terminator);
+        if (branch && branch->isUnconditional())
+        {
+            continue;
+        }
+        std::vector<BasicBlock *> &dependents = dependences[&block];
+        DomTreeNode *blockNode = postDominators.getNode(&block);
+        DomTreeNode *stop = blockNode ? blockNode->getIDom() : nullptr;
+        for (unsigned i = 0; i < terminator->getNumSuccessors(); i++)
+        {
+            // 沿后支配树向上，直到 A 的直接后支配者；虚拟根节点没有对应的基本块
+            for (DomTreeNode *node = postDominators.getNode(terminator->getSuccessor(i)); node && node != stop; node = node->getIDom())
+            {
+                BasicBlock *dependent = node->getBlock();
+                if (dependent && std::find(dependents.begin(), dependents.end(), dependent) == dependents.end())
+                {
+                    dependents.push_back(dependent);
+                }
+            }
+        }
+    }
+}
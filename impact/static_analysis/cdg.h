@@ -0,0 +1,19 @@
+#ifndef CDG_H
+#define CDG_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instructions.h"
+
+#include <vector>
+#include <unordered_map>
+
+using namespace llvm;
+
+// 以 br/switch 结尾的基本块 -> 控制依赖于该分支的基本块
+typedef std::unordered_map<BasicBlock *, std::vector<BasicBlock *>> ControlDependences;
+
+// 函数内的控制依赖，由后支配树求出：对每条边 A -> B，B 在后支配树上到 A 的直接后支配者（不含）之间的基本块都控制依赖于 A
+// 只与函数有关，由 IA 按函数缓存
+void collectControlDependences(Function &function, ControlDependences &dependences);
+#endif // CDG_H
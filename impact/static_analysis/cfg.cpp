@@ -1,4 +1,8 @@
 #include "cfg.h"
+#include "module_cache.h"
+#include "points_to.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/Operator.h"
 
 std::unordered_map<CallInst *, std::vector<Function *>> getAllPossibleCallTargets(IA &ia)
 {
@@ -57,7 +61,7 @@ void getAllFuncInfo(IA &ia)
     }
 }
 
-IndirectCallInfo getCallStatementInfo(llvm::CallInst *callStatement, IA &ia)
+IndirectCallInfo getCallStatementInfo(llvm::CallBase *callStatement, IA &ia)
 {
     if (!callStatement)
     {
@@ -84,103 +88,598 @@ IndirectCallInfo getCallStatementInfo(llvm::CallInst *callStatement, IA &ia)
     return IndirectCallInfo(callStatement, return_type, arg_types);
 }
 
+// 使用 --jobs 时模块分属不同的 LLVMContext，同一 context 中重名的结构体类型会被改名为 %struct.foo.N，
+// 同一类型可能是不同的 Type*，因此按结构比较
+bool isSameType(Type *a, Type *b)
+{
+    if (a == b)
+    {
+        return true;
+    }
+    if (!a || !b || a->getTypeID() != b->getTypeID())
+    {
+        return false;
+    }
+    switch (a->getTypeID())
+    {
+    case Type::IntegerTyID:
+        return a->getIntegerBitWidth() == b->getIntegerBitWidth();
+    case Type::PointerTyID:
+        return a->getPointerAddressSpace() == b->getPointerAddressSpace() && isSameType(a->getPointerElementType(), b->getPointerElementType());
+    case Type::StructTyID:
+    {
+        StructType *sa = cast<StructType>(a);
+        StructType *sb = cast<StructType>(b);
+        if (sa->hasName() || sb->hasName())
+        {
+            return sa->hasName() && sb->hasName() && stripTypeVersion(sa->getName()) == stripTypeVersion(sb->getName());
+        }
+        if (sa->getNumElements() != sb->getNumElements() || sa->isPacked() != sb->isPacked())
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < sa->getNumElements(); i++)
+        {
+            if (!isSameType(sa->getElementType(i), sb->getElementType(i)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    case Type::ArrayTyID:
+        return a->getArrayNumElements() == b->getArrayNumElements() && isSameType(a->getArrayElementType(), b->getArrayElementType());
+    case Type::FixedVectorTyID:
+        return cast<FixedVectorType>(a)->getNumElements() == cast<FixedVectorType>(b)->getNumElements() && isSameType(cast<FixedVectorType>(a)->getElementType(), cast<FixedVectorType>(b)->getElementType());
+    case Type::FunctionTyID:
+    {
+        FunctionType *fa = cast<FunctionType>(a);
+        FunctionType *fb = cast<FunctionType>(b);
+        if (fa->isVarArg() != fb->isVarArg() || fa->getNumParams() != fb->getNumParams() || !isSameType(fa->getReturnType(), fb->getReturnType()))
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < fa->getNumParams(); i++)
+        {
+            if (!isSameType(fa->getParamType(i), fb->getParamType(i)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+static bool matchesCall(Function *function, const IndirectCallInfo &iCallInfo)
+{
+    FunctionType *functionType = function->getFunctionType();
+    if (!isSameType(functionType->getReturnType(), iCallInfo.getReturnType()) || functionType->getNumParams() != iCallInfo.getArgTypes().size())
+    {
+        return false;
+    }
+    for (unsigned i = 0; i < functionType->getNumParams(); i++)
+    {
+        if (!isSameType(functionType->getParamType(i), iCallInfo.getArgType(i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 候选函数按 getSignatureHash 分桶，只需比较一个桶
+// 地址从未被取用的函数不可能是间接调用的目标，无论签名是否匹配
 void analyzeICall(IndirectCallInfo &iCallInfo, IA &ia)
 {
-    std::vector<FunctionInformation> functionInfos = ia.getFunctionInfos();
-    for (FunctionInformation funcInfo : functionInfos)
+    uint64_t signatureHash = getSignatureHash(iCallInfo.getReturnType(), iCallInfo.getArgTypes());
+    for (Function *function : ia.getSignatureBucket(signatureHash))
+    {
+        if (ia.isAddressTaken(function) && matchesCall(function, iCallInfo))
+        {
+            iCallInfo.addPossibleCallee(function);
+        }
+    }
+}
+
+static Value *stripCasts(Value *value)
+{
+    while (isa<BitCastOperator>(value) || isa<AddrSpaceCastOperator>(value))
+    {
+        value = cast<Operator>(value)->getOperand(0);
+    }
+    return value;
+}
+
+// 多层类型分析：从具名结构体字段中读出的函数指针，只可能是程序中存入过该字段的函数之一，
+// 除非该字段被写入未知值或其地址逃逸。字段的键为去掉 .N 后缀的结构体名与字段序号，空串表示不是具名结构体的字段
+std::string getStructFieldKey(Value *pointer)
+{
+    pointer = stripCasts(pointer);
+    StructType *structType = nullptr;
+    unsigned field = 0;
+    Type *pointeeType = nullptr;
+    if (auto *gep = dyn_cast<GEPOperator>(pointer))
+    {
+        for (auto it = gep_type_begin(gep); it != gep_type_end(gep); ++it)
+        {
+            if (StructType *indexed = it.getStructTypeOrNull())
+            {
+                structType = indexed;
+                field = cast<ConstantInt>(it.getOperand())->getZExtValue();
+            }
+        }
+        pointeeType = gep->getResultElementType();
+    }
+    else if (pointer->getType()->isPointerTy())
+    {
+        pointeeType = pointer->getType()->getPointerElementType();
+    }
+    // 字段本身是结构体时，指针存放在它的第一个字段中
+    while (auto *inner = dyn_cast_or_null<StructType>(pointeeType))
+    {
+        if (inner->isOpaque() || inner->getNumElements() == 0)
+        {
+            break;
+        }
+        structType = inner;
+        field = 0;
+        pointeeType = inner->getElementType(0);
+    }
+    if (!structType || !structType->hasName())
+    {
+        return "";
+    }
+    return stripTypeVersion(structType->getName()).str() + ":" + std::to_string(field);
+}
+
+// 地址被当作值使用的字段的键，例如传给可能向其中写入任意函数的函数
+static std::string getEscapingFieldKey(Value *value)
+{
+    if (!value->getType()->isPointerTy() || !isa<GEPOperator>(stripCasts(value)))
     {
+        return "";
+    }
+    return getStructFieldKey(value);
+}
 
-        if (funcInfo.getReturnType() == iCallInfo.getReturnType() && funcInfo.getNumArgs() == iCallInfo.getNumArgs() && funcInfo.getArgTypes() == iCallInfo.getArgTypes())
+void collectFieldStores(Function &function, FieldStores &fieldStores)
+{
+    for (auto &inst : instructions(function))
+    {
+        if (auto *store = dyn_cast<StoreInst>(&inst))
+        {
+            std::string fieldKey = getStructFieldKey(store->getPointerOperand());
+            Value *value = stripCasts(store->getValueOperand());
+            if (auto *stored = dyn_cast<Function>(value))
+            {
+                // 经匿名结构体存入的函数无法归到某个字段
+                if (!fieldKey.empty() || isa<GEPOperator>(stripCasts(store->getPointerOperand())))
+                {
+                    fieldStores.functions.emplace_back(fieldKey, stored);
+                }
+            }
+            else if (!fieldKey.empty() && value->getType()->isPointerTy() && !isa<ConstantPointerNull>(value) && !isa<UndefValue>(value))
+            {
+                fieldStores.escaped.push_back(fieldKey);
+            }
+            std::string escapingKey = getEscapingFieldKey(store->getValueOperand());
+            if (!escapingKey.empty())
+            {
+                fieldStores.escaped.push_back(escapingKey);
+            }
+        }
+        else if (auto *callInst = dyn_cast<CallBase>(&inst))
         {
-            // errs() << "Found matching function: " << funcInfo.getFunction()->getName().str() << " in file " << funcInfo.getFunction()->getParent()->getSourceFileName() << "\n";
-            iCallInfo.addPossibleCallee(funcInfo.getFunction());
+            for (auto &arg : callInst->args())
+            {
+                std::string escapingKey = getEscapingFieldKey(arg);
+                if (!escapingKey.empty())
+                {
+                    fieldStores.escaped.push_back(escapingKey);
+                }
+            }
+        }
+        else if (auto *returnInst = dyn_cast<ReturnInst>(&inst))
+        {
+            std::string escapingKey = returnInst->getReturnValue() ? getEscapingFieldKey(returnInst->getReturnValue()) : "";
+            if (!escapingKey.empty())
+            {
+                fieldStores.escaped.push_back(escapingKey);
+            }
         }
     }
 }
 
-void analyzeAllICalls(IA &ia)
+void collectInitializerFields(Constant *constant, const std::string &fieldKey, FieldStores &fieldStores)
 {
-    std::cout << "Analyzing all indirect calls possible callees\n";
-    for (auto icall : ia.getIndirectCalls())
+    Value *stripped = stripCasts(constant);
+    if (auto *function = dyn_cast<Function>(stripped))
     {
-        CallInst *callInst = dyn_cast<CallInst>(icall);
-        IndirectCallInfo ici = getCallStatementInfo(callInst, ia);
-        analyzeICall(ici, ia);
-        // ici.print();
-        ia.addICallInfo(ici);
+        fieldStores.functions.emplace_back(fieldKey, function);
+        return;
+    }
+    if (isa<GEPOperator>(stripped))
+    {
+        std::string escapingKey = getStructFieldKey(stripped);
+        if (!escapingKey.empty())
+        {
+            fieldStores.escaped.push_back(escapingKey);
+        }
+        return;
+    }
+    if (auto *structConstant = dyn_cast<ConstantStruct>(constant))
+    {
+        StructType *structType = structConstant->getType();
+        for (unsigned i = 0; i < structConstant->getNumOperands(); i++)
+        {
+            std::string elementKey = structType->hasName() ? stripTypeVersion(structType->getName()).str() + ":" + std::to_string(i) : "";
+            collectInitializerFields(structConstant->getOperand(i), elementKey, fieldStores);
+        }
+    }
+    else if (isa<ConstantArray>(constant) || isa<ConstantVector>(constant))
+    {
+        for (Value *element : constant->operands())
+        {
+            collectInitializerFields(cast<Constant>(element), fieldKey, fieldStores);
+        }
     }
 }
 
-std::vector<Instruction *> getFunctionCallSites(Function *func, IA &ia)
+// 调用目标不是从索引能够确定的字段中读出时返回 false
+static bool getFieldTargets(CallBase *callInst, IndirectCallInfo &iCallInfo, IA &ia, std::vector<Function *> &targets)
 {
-    // std::cout << "Getting all call sites for function: " << func->getName().str() << "\n";
-    const std::vector<FunctionCaller> &functionCallers = ia.getFunctionCallers();
-    // for (FunctionCaller fc : functionCallers)
-    // {
-    //     fc.print();
-    // }
+    auto *load = dyn_cast<LoadInst>(stripCasts(callInst->getCalledOperand()));
+    if (!load)
+    {
+        return false;
+    }
+    std::string fieldKey = getStructFieldKey(load->getPointerOperand());
+    const std::vector<Function *> *functions = fieldKey.empty() ? nullptr : ia.getFieldFunctions(fieldKey);
+    if (!functions)
+    {
+        return false;
+    }
+    targets = *functions;
+    if (const std::vector<Function *> *unattributed = ia.getFieldFunctions(""))
+    {
+        for (Function *function : *unattributed)
+        {
+            if (matchesCall(function, iCallInfo) && std::find(targets.begin(), targets.end(), function) == targets.end())
+            {
+                targets.push_back(function);
+            }
+        }
+    }
+    return true;
+}
 
-    for (FunctionCaller fc : functionCallers)
+// 虚表全局变量中给定字节偏移处存放的函数，没有时返回 nullptr
+static Function *getVTableEntry(GlobalVariable *vtable, uint64_t offset)
+{
+    const DataLayout &dataLayout = vtable->getParent()->getDataLayout();
+    Constant *entry = vtable->getInitializer();
+    while (true)
     {
-        if (fc.getFunction()->getName() == func->getName())
+        if (auto *structConstant = dyn_cast<ConstantStruct>(entry))
+        {
+            const StructLayout *layout = dataLayout.getStructLayout(structConstant->getType());
+            if (offset >= layout->getSizeInBytes())
+            {
+                return nullptr;
+            }
+            unsigned i = layout->getElementContainingOffset(offset);
+            offset -= layout->getElementOffset(i);
+            entry = structConstant->getOperand(i);
+        }
+        else if (auto *arrayConstant = dyn_cast<ConstantArray>(entry))
         {
-            // errs() << "Function fc: " << fc.getFunction()->getName() << "\n";
-            // errs() << "Function func : " << func->getName() << "\n";
-            std::vector<Instruction *> callSites = fc.getPossibleCallers();
-            // for (Instruction *inst : callSites)
-            // {
-            //     errs() << "Call site: " << *inst << "\n";
-            // }
-            return callSites;
+            uint64_t entrySize = dataLayout.getTypeAllocSize(arrayConstant->getType()->getElementType());
+            uint64_t i = offset / entrySize;
+            if (i >= arrayConstant->getNumOperands())
+            {
+                return nullptr;
+            }
+            offset -= i * entrySize;
+            entry = arrayConstant->getOperand(i);
+        }
+        else
+        {
+            break;
         }
     }
-    // std::cout << "No call sites found for function: " << func->getName().str() << "\n";
-    return std::vector<Instruction *>();
+    return offset == 0 ? dyn_cast<Function>(entry->stripPointerCasts()) : nullptr;
 }
 
-void pointerAnalysis(IA &ia)
+// 虚表指针上 llvm.type.test（或 llvm.public.type.test）的类型 ID，clang 在 -fwhole-program-vtables 与 CFI 下生成
+static std::string getTypeTestId(Value *vtablePointer)
 {
-    llvm::AAResults &aliasAnalysis = ia.getAliasAnalysis();
+    std::vector<Value *> worklist = {vtablePointer};
+    while (!worklist.empty())
+    {
+        Value *value = worklist.back();
+        worklist.pop_back();
+        for (User *user : value->users())
+        {
+            if (isa<BitCastOperator>(user))
+            {
+                worklist.push_back(user);
+                continue;
+            }
+            auto *callInst = dyn_cast<CallInst>(user);
+            Function *callee = callInst ? callInst->getCalledFunction() : nullptr;
+            if (!callee || (callee->getName() != "llvm.type.test" && callee->getName() != "llvm.public.type.test"))
+            {
+                continue;
+            }
+            if (auto *metadata = dyn_cast<MetadataAsValue>(callInst->getArgOperand(1)))
+            {
+                if (auto *typeId = dyn_cast<MDString>(metadata->getMetadata()))
+                {
+                    return typeId->getString().str();
+                }
+            }
+        }
+    }
+    return "";
+}
 
-    for (auto &ici : ia.getICallInfos())
+// C++ 虚调用从虚表的常量偏移处读出目标，虚表指针则从对象中读出；返回读取虚表指针的 load
+static LoadInst *getVTableLoad(CallBase *callInst, uint64_t &slotOffset)
+{
+    auto *load = dyn_cast<LoadInst>(stripCasts(callInst->getCalledOperand()));
+    if (!load)
     {
-        CallInst *callInst = dyn_cast<CallInst>(ici.getCallInst());
-        if (!callInst)
+        return nullptr;
+    }
+    Value *vtable = stripCasts(load->getPointerOperand());
+    slotOffset = 0;
+    if (auto *gep = dyn_cast<GEPOperator>(vtable))
+    {
+        // 虚表槽按指针数组索引，不会是结构体字段
+        const DataLayout &dataLayout = callInst->getModule()->getDataLayout();
+        APInt offset(dataLayout.getIndexTypeSizeInBits(gep->getType()), 0);
+        if (gep->getNumIndices() != 1 || gep->getSourceElementType()->isAggregateType() || !gep->accumulateConstantOffset(dataLayout, offset))
         {
-            errs() << "Skipping null CallInst in pointerAnalysis\n";
-            continue;
+            return nullptr;
         }
+        slotOffset = offset.getZExtValue();
+        vtable = stripCasts(gep->getPointerOperand());
+    }
+    return dyn_cast<LoadInst>(vtable);
+}
 
-        const std::vector<Function *> &typeAnalysisCallees = ici.getPossibleCallees();
-        std::vector<Function *> filteredCallees;
+bool isVirtualCall(CallBase *callInst)
+{
+    uint64_t slotOffset;
+    return getVTableLoad(callInst, slotOffset) != nullptr;
+}
 
-        Value *calledOperand = callInst->getCalledOperand();
-        if (!calledOperand)
+// 虚调用的被调函数是静态类型及其派生类的虚表中对应槽位的函数之一；调用不是这种形式或类未知时返回空
+static std::vector<Function *> getVirtualTargets(CallBase *callInst, IA &ia)
+{
+    std::vector<Function *> targets;
+    uint64_t slotOffset;
+    LoadInst *vtableLoad = getVTableLoad(callInst, slotOffset);
+    if (!vtableLoad)
+    {
+        return targets;
+    }
+    std::vector<std::string> typeIds;
+    std::string typeTestId = getTypeTestId(vtableLoad);
+    if (!typeTestId.empty())
+    {
+        typeIds.push_back(typeTestId);
+    }
+    else
+    {
+        Type *objectType = stripCasts(vtableLoad->getPointerOperand())->getType()->getPointerElementType();
+        auto *classType = dyn_cast<StructType>(objectType);
+        const std::vector<std::string> *classTypeIds = classType ? ia.getClassTypeIds(classType) : nullptr;
+        if (!classTypeIds)
         {
-            errs() << "Skipping null CalledOperand for CallInst: " << *callInst << "\n";
-            continue;
+            return targets;
+        }
+        typeIds = *classTypeIds;
+    }
+    std::unordered_set<unsigned> seen;
+    for (auto &typeId : typeIds)
+    {
+        for (auto &addressPoint : ia.getVTableAddressPoints(typeId))
+        {
+            // 重写函数与调整 this 的 thunk 以派生类为 this，返回值也可能协变，因此只检查参数个数
+            Function *callee = getVTableEntry(addressPoint.first, addressPoint.second + slotOffset);
+            if (callee && callee->arg_size() == callInst->arg_size() && seen.insert(ia.getFunctionId(callee)).second)
+            {
+                targets.push_back(callee);
+            }
         }
+    }
+    return targets;
+}
 
-        for (Function *callee : typeAnalysisCallees)
+// 运行时观察到的目标（--icall-profile）优先；使用 --icall-profile-only 时未执行过的调用没有被调函数。
+// 虚调用按类层次解析。其余情况下字段索引与指针分析都是过近似，两者都能解析时取二者的交集；
+// 函数指针可能来自未建模的来源时，指针分析的结果不完整，取其与签名匹配结果的并集；
+// 都无法解析的调用（以及懒加载时没有指针分析、又不是从已索引字段读出目标的调用）退回签名匹配
+static void resolveICallTargets(IndirectCallInfo &iCallInfo, IA &ia)
+{
+    CallBase *callInst = dyn_cast<CallBase>(iCallInfo.getCallInst());
+    if (!callInst)
+    {
+        analyzeICall(iCallInfo, ia);
+        return;
+    }
+    if (ia.hasICallProfile())
+    {
+        std::vector<Function *> observedTargets = ia.getObservedTargets(callInst);
+        for (Function *callee : observedTargets)
+        {
+            iCallInfo.addPossibleCallee(callee);
+        }
+        if (!observedTargets.empty() || ia.isICallProfileOnly())
+        {
+            return;
+        }
+    }
+    std::vector<Function *> virtualTargets = getVirtualTargets(callInst, ia);
+    if (!virtualTargets.empty())
+    {
+        for (Function *callee : virtualTargets)
+        {
+            iCallInfo.addPossibleCallee(callee);
+        }
+        return;
+    }
+    PointsToAnalysis *pointsTo = ia.getPointsTo();
+    std::vector<unsigned> pointsToTargets = pointsTo ? pointsTo->getFunctionTargets(callInst->getCalledOperand()) : std::vector<unsigned>();
+    if (pointsTo && pointsTo->isUnknown(callInst->getCalledOperand()))
+    {
+        for (unsigned functionId : pointsToTargets)
+        {
+            if (Function *callee = ia.getFunctionById(functionId))
+            {
+                iCallInfo.addPossibleCallee(callee);
+            }
+        }
+        uint64_t signatureHash = getSignatureHash(iCallInfo.getReturnType(), iCallInfo.getArgTypes());
+        for (Function *function : ia.getSignatureBucket(signatureHash))
+        {
+            if (ia.isAddressTaken(function) && matchesCall(function, iCallInfo) && !std::binary_search(pointsToTargets.begin(), pointsToTargets.end(), ia.getFunctionId(function)))
+            {
+                iCallInfo.addPossibleCallee(function);
+            }
+        }
+        return;
+    }
+    std::vector<Function *> fieldTargets;
+    if (getFieldTargets(callInst, iCallInfo, ia, fieldTargets))
+    {
+        for (Function *callee : fieldTargets)
         {
-            if (aliasAnalysis.alias(calledOperand, callee) != llvm::NoAlias)
+            if (pointsToTargets.empty() || std::binary_search(pointsToTargets.begin(), pointsToTargets.end(), ia.getFunctionId(callee)))
             {
-                filteredCallees.push_back(callee); // 仅保留可能的目标
+                iCallInfo.addPossibleCallee(callee);
             }
         }
+        if (!iCallInfo.getPossibleCallees().empty())
+        {
+            return;
+        }
+    }
+    for (unsigned functionId : pointsToTargets)
+    {
+        if (Function *callee = ia.getFunctionById(functionId))
+        {
+            iCallInfo.addPossibleCallee(callee);
+        }
+    }
+    if (iCallInfo.getPossibleCallees().empty())
+    {
+        analyzeICall(iCallInfo, ia);
+    }
+}
 
-        if (filteredCallees.empty())
+// resolveICallTargets 中除签名桶以外的全部输入：运行时记录、虚表、指针分析与字段索引给出的目标。
+// 哈希不变、调用的签名桶也没有增减取地址的函数时，重新解析得到的候选与原来相同
+uint64_t getICallInputsHash(IndirectCallInfo &iCallInfo, IA &ia)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    // 各来源的目标顺序取决于模块的加载顺序，排序后再计入哈希
+    auto hashTargets = [&hash](std::vector<Function *> targets)
+    {
+        std::sort(targets.begin(), targets.end());
+        for (Function *target : targets)
+        {
+            hash = (hash ^ reinterpret_cast<uintptr_t>(target)) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ targets.size()) * 0x100000001b3ULL;
+    };
+    CallBase *callInst = dyn_cast<CallBase>(iCallInfo.getCallInst());
+    if (!callInst)
+    {
+        return hash;
+    }
+    hashTargets(ia.hasICallProfile() ? ia.getObservedTargets(callInst) : std::vector<Function *>());
+    hashTargets(getVirtualTargets(callInst, ia));
+    std::vector<Function *> pointsToTargets;
+    PointsToAnalysis *pointsTo = ia.getPointsTo();
+    if (pointsTo)
+    {
+        for (unsigned functionId : pointsTo->getFunctionTargets(callInst->getCalledOperand()))
         {
-            filteredCallees = typeAnalysisCallees;
+            pointsToTargets.push_back(ia.getFunctionById(functionId));
         }
+    }
+    hashTargets(pointsToTargets);
+    std::vector<Function *> fieldTargets;
+    bool fromField = getFieldTargets(callInst, iCallInfo, ia, fieldTargets);
+    hashTargets(fieldTargets);
+    hash = (hash ^ (fromField << 1 | (pointsTo && pointsTo->isUnknown(callInst->getCalledOperand())))) * 0x100000001b3ULL;
+    return hash;
+}
 
-        ici.setPossibleCallees(filteredCallees); // 使用 setter 方法更新
+// 指定 --entry 时，入口不可达的函数中的调用不解析，不可达的函数也从被调函数中去掉
+void resolveICall(IndirectCallInfo &iCallInfo, IA &ia)
+{
+    if (!ia.hasEntries())
+    {
+        resolveICallTargets(iCallInfo, ia);
+        return;
+    }
+    if (ia.isPruned(iCallInfo.getCallInst()->getFunction()))
+    {
+        return;
+    }
+    resolveICallTargets(iCallInfo, ia);
+    std::vector<Function *> callees = iCallInfo.getPossibleCallees();
+    callees.erase(std::remove_if(callees.begin(), callees.end(), [&ia](Function *callee)
+                                 { return ia.isPruned(callee); }),
+                  callees.end());
+    iCallInfo.setPossibleCallees(callees);
+}
 
-        // errs() << "Call Instruction: " << *callInst << "\n";
-        // errs() << "Filtered Possible Callees:\n";
-        for (Function *func : filteredCallees)
+void analyzeAllICalls(IA &ia)
+{
+    std::cout << "Analyzing all indirect calls possible callees\n";
+    // 懒加载时此处只包含已物化函数中的间接调用，与查询有关，不使用程序级缓存
+    // 使用间接调用记录时结果还取决于记录文件，同样不使用
+    bool useCache = ia.isCacheEnabled() && !ia.isLazyLoad() && !ia.hasICallProfile();
+    if (useCache && readICallCache(ia))
+    {
+        std::cout << "Loaded indirect call candidates from cache\n";
+        return;
+    }
+    if (!ia.isICallProfileOnly())
+    {
+        ia.buildFieldIndex();
+        ia.buildVTableIndex();
+        ia.buildPointsTo();
+    }
+    for (auto icall : ia.getIndirectCalls())
+    {
+        CallBase *callInst = dyn_cast<CallBase>(icall);
+        IndirectCallInfo ici = getCallStatementInfo(callInst, ia);
+        resolveICall(ici, ia);
+        // ici.print();
+        if (ia.isWatchMode())
         {
-            errs() << "  " << func->getName() << "\n";
+            ia.setICallInputs(callInst, getICallInputsHash(ici, ia));
         }
+        ia.addICallInfo(ici);
     }
-}
\ No newline at end of file
+    if (useCache)
+    {
+        writeICallCache(ia);
+    }
+}
+
+const std::vector<Instruction *> &getFunctionCallSites(Function *func, IA &ia)
+{
+    // std::cout << "Getting all call sites for function: " << func->getName().str() << "\n";
+    ia.materializeCallersOf(func);
+    // 调用方模块中的声明与定义共用规范 ID，一次查找即可得到全部调用点
+    return ia.getCallSites(func);
+}
@@ -9,9 +9,16 @@ using namespace llvm;
 std::unordered_map<CallInst *, std::vector<Function *>> getAllPossibleCallTargets(IA &ia);
 std::vector<Function *> indirectCallAnalyze(CallInst *callStatement);
 void getAllFuncInfo(IA &ia);
-IndirectCallInfo getCallStatementInfo(llvm::CallInst *callStatement, IA &ia);
+IndirectCallInfo getCallStatementInfo(llvm::CallBase *callStatement, IA &ia);
+bool isSameType(Type *a, Type *b);
 void analyzeICall(IndirectCallInfo &iCallInfo, IA &ia);
+void resolveICall(IndirectCallInfo &iCallInfo, IA &ia);
+uint64_t getICallInputsHash(IndirectCallInfo &iCallInfo, IA &ia);
+bool isVirtualCall(CallBase *callInst);
+std::string getStructFieldKey(Value *pointer);
+void collectFieldStores(Function &function, FieldStores &fieldStores);
+void collectInitializerFields(Constant *constant, const std::string &fieldKey, FieldStores &fieldStores);
 void analyzeAllICalls(IA &ia);
-std::vector<Instruction *> getFunctionCallSites(Function *func, IA &ia);
+const std::vector<Instruction *> &getFunctionCallSites(Function *func, IA &ia);
 
 #endif
\ No newline at end of file
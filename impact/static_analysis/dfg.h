@@ -24,58 +24,7 @@
 
 using namespace llvm;
 
-class DFGNode
-{
-public:
-    using Ptr = std::shared_ptr<DFGNode>;
-    using WeakPtr = std::weak_ptr<DFGNode>;
-    using InstructionPtr = llvm::Instruction *;
-
-private:
-    InstructionPtr instruction;
-    std::vector<Ptr> uses;
-    std::vector<WeakPtr> defs;
-
-public:
-    DFGNode(InstructionPtr inst) : instruction(inst) {}
-
-    void addUse(Ptr use)
-    {
-        uses.push_back(std::move(use));
-    }
-
-    void addDef(Ptr def)
-    {
-        defs.push_back(def);
-    }
-
-    InstructionPtr getInstruction() const
-    {
-        return instruction;
-    }
-
-    const std::vector<Ptr> &getUses() const
-    {
-        return uses;
-    }
-
-    std::vector<Ptr> getDefs() const
-    {
-        std::vector<Ptr> result;
-        for (const auto &weakDef : defs)
-        {
-            if (auto def = weakDef.lock())
-            {
-                result.push_back(def);
-            }
-        }
-        return result;
-    }
-};
-
-std::vector<std::string> analyzeChangedInstructions(std::vector<llvm::Instruction *> changedInsts);
-std::vector<DFGNode::Ptr> analyzeDataFlow(llvm::Instruction *startInst);
-void identifyDependents(DFGNode::Ptr dfgNode, std::vector<DFGNode::Ptr> dfgNodes);
-std::vector<Instruction *> getGlobalVariableUses(llvm::GlobalVariable *GV);
-void findAllUses(IMPACT &impact, DFGNode::Ptr node, std::vector<DFGNode::Ptr> &visitedNodes);
+// 函数内的数据依赖：使用了本函数中其他指令结果的全部指令（按函数中的顺序）
+// 与数据流图中从所有节点出发求使用闭包的结果相同，只与函数有关，由 IA 按函数缓存
+void collectDataFlowUses(Function &function, std::vector<Instruction *> &uses);
 #endif // DFG_H
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "cfg.h"
 #include "dfg.h"
 #include "sdg.h"
+#include "server.h"
 
 int main(int argc, char **argv)
 {
@@ -10,15 +11,21 @@ int main(int argc, char **argv)
 
     IA ia;
     bool writeIFiles = ia.argsHandle(argc, argv);
+    if (ia.isServeMode() && ia.getServeSocket().empty())
+    {
+        // stdout 留给查询结果，加载与建索引的进度信息转到 stderr
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
     ia.parseFiles(context);
+    if (ia.isServeMode())
+    {
+        buildIndexes(ia);
+        serveQueries(ia);
+        return 0;
+    }
     ia.compareChanges();
     auto start = std::chrono::high_resolution_clock::now();
-    ia.getAllGVs();
-    ia.analyzeAllCallInsts();
-    getAllFuncInfo(ia);
-    analyzeAllICalls(ia);
-    ia.parseICallInfos();
-    ia.parseDirectCalls();
+    buildIndexes(ia);
     checkChanges(ia);
     ia.parseSourceLine();
     auto end = std::chrono::high_resolution_clock::now();
@@ -32,10 +39,7 @@ int main(int argc, char **argv)
     {
         ia.write_impacts();
     }
-    for (auto impact : ia.getImpacts())
-    {
-        impact.writeFinalResult();
-    }
+    ia.writeFinalResult();
 
     std::cout << "Elapsed time: " << elapsed.count() << " s\n";
     return 0;
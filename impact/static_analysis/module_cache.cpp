@@ -0,0 +1,328 @@
+#include "module_cache.h"
+#include "cfg.h"
+
+static const char *moduleCacheHeader = "IACACHE 6";
+static const char *iCallCacheHeader = "IACACHE-ICALLS 7";
+
+std::string getContentHash(StringRef data)
+{
+    return llvm::utohexstr(llvm::xxHash64(data), true);
+}
+
+// 写入临时文件后再重命名，避免并发运行时读到写了一半的缓存
+static bool replaceCacheFile(const std::string &cachePath, const std::string &content)
+{
+    std::string tmpPath = cachePath + ".tmp" + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmpPath, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        file << content;
+        if (!file)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if (ec)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readModuleCache(const std::string &cachePath, Module &module, std::vector<std::pair<Function *, FunctionSummary>> &summaries)
+{
+    std::ifstream file(cachePath);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<Function *> functions;
+    for (auto &function : module)
+    {
+        functions.push_back(&function);
+    }
+    std::vector<GlobalVariable *> globals;
+    for (auto &gv : module.globals())
+    {
+        globals.push_back(&gv);
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != moduleCacheHeader)
+    {
+        return false;
+    }
+    summaries.clear();
+    FunctionSummary *summary = nullptr;
+    std::set<unsigned> *lines = nullptr;
+    while (std::getline(file, line))
+    {
+        std::istringstream record(line);
+        std::string kind;
+        record >> kind;
+        if (kind == "functions")
+        {
+            size_t count = 0;
+            record >> count;
+            if (count != functions.size())
+            {
+                return false;
+            }
+        }
+        else if (kind == "function")
+        {
+            size_t index = functions.size();
+            record >> index;
+            if (index >= functions.size())
+            {
+                return false;
+            }
+            summaries.emplace_back(functions[index], FunctionSummary());
+            summary = &summaries.back().second;
+            lines = nullptr;
+        }
+        else if (!summary)
+        {
+            return false;
+        }
+        else if (kind == "file")
+        {
+            lines = &summary->lines[line.substr(5)];
+        }
+        else if (kind == "lines" && lines)
+        {
+            unsigned lineNumber;
+            while (record >> lineNumber)
+            {
+                lines->insert(lineNumber);
+            }
+        }
+        else if (kind == "direct" || kind == "indirect")
+        {
+            unsigned index;
+            record >> index;
+            std::string rest;
+            std::getline(record, rest);
+            if (!record.eof() || rest.empty())
+            {
+                return false;
+            }
+            rest = rest.substr(1);
+            if (kind == "direct")
+            {
+                summary->directCallIndexes.push_back(index);
+                summary->directCallees.push_back(rest);
+            }
+            else
+            {
+                summary->indirectCallIndexes.push_back(index);
+                summary->iCallSignatures.push_back(rest);
+            }
+        }
+        else if (kind == "address")
+        {
+            size_t index = functions.size();
+            record >> index;
+            if (index >= functions.size())
+            {
+                return false;
+            }
+            summary->addressTakenFunctions.push_back(functions[index]);
+        }
+        else if (kind == "fieldfn")
+        {
+            size_t index = functions.size();
+            record >> index;
+            if (index >= functions.size())
+            {
+                return false;
+            }
+            std::string fieldKey;
+            std::getline(record, fieldKey);
+            summary->fieldStores.functions.emplace_back(fieldKey.empty() ? "" : fieldKey.substr(1), functions[index]);
+        }
+        else if (kind == "fieldesc")
+        {
+            summary->fieldStores.escaped.push_back(line.substr(9));
+        }
+        else if (kind == "body")
+        {
+            record >> summary->bodyHash;
+        }
+        else if (kind == "global")
+        {
+            size_t index = globals.size();
+            record >> index;
+            if (index >= globals.size())
+            {
+                return false;
+            }
+            summary->globalVariables.push_back(globals[index]);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void writeModuleCache(const std::string &cachePath, Module &module, const std::vector<std::pair<Function *, FunctionSummary>> &summaries)
+{
+    std::unordered_map<Function *, size_t> functionIndexes;
+    for (auto &function : module)
+    {
+        functionIndexes.emplace(&function, functionIndexes.size());
+    }
+    std::unordered_map<GlobalVariable *, size_t> globalIndexes;
+    for (auto &gv : module.globals())
+    {
+        globalIndexes.emplace(&gv, globalIndexes.size());
+    }
+
+    std::ostringstream content;
+    content << moduleCacheHeader << "\n";
+    content << "functions " << functionIndexes.size() << "\n";
+    for (auto &entry : summaries)
+    {
+        const FunctionSummary &summary = entry.second;
+        content << "function " << functionIndexes[entry.first] << "\n";
+        for (auto &fileLines : summary.lines)
+        {
+            content << "file " << fileLines.first << "\n";
+            content << "lines";
+            for (unsigned line : fileLines.second)
+            {
+                content << " " << line;
+            }
+            content << "\n";
+        }
+        for (size_t i = 0; i < summary.directCallIndexes.size(); i++)
+        {
+            content << "direct " << summary.directCallIndexes[i] << " " << summary.directCallees[i] << "\n";
+        }
+        for (size_t i = 0; i < summary.indirectCallIndexes.size(); i++)
+        {
+            content << "indirect " << summary.indirectCallIndexes[i] << " " << summary.iCallSignatures[i] << "\n";
+        }
+        for (auto *gv : summary.globalVariables)
+        {
+            content << "global " << globalIndexes[gv] << "\n";
+        }
+        for (auto *function : summary.addressTakenFunctions)
+        {
+            content << "address " << functionIndexes[function] << "\n";
+        }
+        for (auto &stored : summary.fieldStores.functions)
+        {
+            content << "fieldfn " << functionIndexes[stored.second] << " " << stored.first << "\n";
+        }
+        for (auto &fieldKey : summary.fieldStores.escaped)
+        {
+            content << "fieldesc " << fieldKey << "\n";
+        }
+        content << "body " << summary.bodyHash << "\n";
+    }
+    if (!replaceCacheFile(cachePath, content.str()))
+    {
+        errs() << "Warning: failed to write cache " << cachePath << "\n";
+    }
+}
+
+// 间接调用的候选函数依赖所有模块，因此按整个程序的哈希缓存，函数记为 模块序号:函数序号
+static std::string getICallCachePath(IA &ia)
+{
+    return ia.getCacheDir() + "/program-" + ia.getProgramHash() + ".icalls";
+}
+
+bool readICallCache(IA &ia)
+{
+    std::ifstream file(getICallCachePath(ia));
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<std::vector<Function *>> functions;
+    for (auto &module : ia.getModules())
+    {
+        functions.emplace_back();
+        for (auto &function : *module)
+        {
+            functions.back().push_back(&function);
+        }
+    }
+
+    std::vector<Instruction *> indirectCalls = ia.getIndirectCalls();
+    std::string line;
+    size_t count = 0;
+    if (!std::getline(file, line) || line != iCallCacheHeader || !(file >> count) || count != indirectCalls.size())
+    {
+        return false;
+    }
+    std::vector<IndirectCallInfo> iCallInfos;
+    for (auto *icall : indirectCalls)
+    {
+        size_t calleeCount = 0;
+        if (!(file >> calleeCount))
+        {
+            return false;
+        }
+        IndirectCallInfo ici = getCallStatementInfo(dyn_cast<CallBase>(icall), ia);
+        for (size_t i = 0; i < calleeCount; i++)
+        {
+            size_t moduleIndex = functions.size();
+            size_t functionIndex = 0;
+            char colon;
+            if (!(file >> moduleIndex >> colon >> functionIndex) || moduleIndex >= functions.size() || functionIndex >= functions[moduleIndex].size())
+            {
+                return false;
+            }
+            ici.addPossibleCallee(functions[moduleIndex][functionIndex]);
+        }
+        iCallInfos.push_back(ici);
+    }
+    for (auto &ici : iCallInfos)
+    {
+        ia.addICallInfo(ici);
+    }
+    return true;
+}
+
+void writeICallCache(IA &ia)
+{
+    std::unordered_map<Function *, std::string> functionIds;
+    size_t moduleIndex = 0;
+    for (auto &module : ia.getModules())
+    {
+        size_t functionIndex = 0;
+        for (auto &function : *module)
+        {
+            functionIds[&function] = std::to_string(moduleIndex) + ":" + std::to_string(functionIndex++);
+        }
+        moduleIndex++;
+    }
+
+    std::ostringstream content;
+    content << iCallCacheHeader << "\n";
+    content << ia.getICallInfos().size() << "\n";
+    for (auto &ici : ia.getICallInfos())
+    {
+        content << ici.getPossibleCallees().size();
+        for (auto *callee : ici.getPossibleCallees())
+        {
+            content << " " << functionIds[callee];
+        }
+        content << "\n";
+    }
+    if (!replaceCacheFile(getICallCachePath(ia), content.str()))
+    {
+        errs() << "Warning: failed to write cache " << getICallCachePath(ia) << "\n";
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef MODULE_CACHE_H
+#define MODULE_CACHE_H
+
+#include "module_parse.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/xxhash.h"
+
+// 缓存文件按 .bc 文件内容的哈希命名，函数与全局变量按其在模块中的序号记录
+std::string getContentHash(StringRef data);
+bool readModuleCache(const std::string &cachePath, Module &module, std::vector<std::pair<Function *, FunctionSummary>> &summaries);
+void writeModuleCache(const std::string &cachePath, Module &module, const std::vector<std::pair<Function *, FunctionSummary>> &summaries);
+bool readICallCache(IA &ia);
+void writeICallCache(IA &ia);
+
+#endif
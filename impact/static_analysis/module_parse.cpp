@@ -1,4 +1,14 @@
 #include "module_parse.h"
+#include "cfg.h"
+#include "module_cache.h"
+#include "points_to.h"
+#include "call_graph.h"
+#include "dfg.h"
+#include "pdg.h"
+#include "llvm/Demangle/Demangle.h"
+
+IA::IA() = default;
+IA::~IA() = default;
 
 // 信号处理 - 用于 debug
 void signalHandler(int signum)
@@ -15,15 +25,150 @@ void signalHandler(int signum)
     exit(1);
 }
 
+static const char *usage = "Usage: <bcoutput dir> <file:inst_no>... [--seeds FILE] [--diff FILE] [-n] [--jobs N] [--lazy] [--lazy-cache N] [--cache] [--cache-dir DIR] [--icall-profile FILE [--icall-profile-only]] [--entry NAME|@FILE]...\n"
+                           "       <bcoutput dir> --serve [--serve-socket PATH] [--watch] [options]\n";
+
 bool IA::argsHandle(int argc, char **argv)
 {
     bool flag = true;
-    if (argc != 3 && argc != 4)
+    std::vector<std::string> positionals;
+    std::vector<std::string> seedFiles;
+    std::vector<std::string> diffFiles;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto nextArg = [&](const char *what) -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                errs() << "Error: " << arg << " requires " << what << "\n";
+                exit(1);
+            }
+            return argv[++i];
+        };
+        if (arg == "-n")
+        {
+            flag = false;
+        }
+        else if (arg == "-j" || arg == "--jobs")
+        {
+            std::string value = nextArg("a number");
+            char *end = nullptr;
+            long parsed = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || parsed < 0 || parsed > INT_MAX)
+            {
+                errs() << "Error: invalid number for " << arg << ": " << value << "\n";
+                errs() << usage;
+                exit(1);
+            }
+            // 0 表示使用全部核
+            jobs = parsed == 0 ? std::max(1u, std::thread::hardware_concurrency()) : static_cast<int>(parsed);
+        }
+        else if (arg == "--cache")
+        {
+            useCache = true;
+        }
+        else if (arg == "--cache-dir")
+        {
+            useCache = true;
+            cacheDir = nextArg("a directory");
+        }
+        else if (arg == "--lazy")
+        {
+            lazyLoad = true;
+        }
+        else if (arg == "--lazy-cache")
+        {
+            lazyLoad = true;
+            std::string value = nextArg("a number");
+            char *end = nullptr;
+            long parsed = std::strtol(value.c_str(), &end, 10);
+            // 0 会在每个种子之后丢弃全部函数体，不接受
+            if (value.empty() || *end != '\0' || parsed < 1)
+            {
+                errs() << "Error: invalid number for " << arg << ": " << value << "\n";
+                errs() << usage;
+                exit(1);
+            }
+            lazyCacheLimit = static_cast<size_t>(parsed);
+        }
+        else if (arg == "--icall-profile")
+        {
+            iCallProfilePath = nextArg("a file");
+        }
+        else if (arg == "--icall-profile-only")
+        {
+            iCallProfileOnly = true;
+        }
+        else if (arg == "--entry")
+        {
+            // 逗号分隔的函数名，或 @FILE：每行一个函数名，忽略空行和 # 开头的注释
+            std::string entry = nextArg("a function name or @FILE");
+            if (entry[0] == '@')
+            {
+                std::ifstream entryFile(entry.substr(1));
+                if (!entryFile)
+                {
+                    errs() << "Error: cannot open entry list " << entry.substr(1) << "\n";
+                    exit(1);
+                }
+                std::string line;
+                while (std::getline(entryFile, line))
+                {
+                    line = StringRef(line).trim().str();
+                    if (!line.empty() && line[0] != '#')
+                    {
+                        entryNames.push_back(line);
+                    }
+                }
+            }
+            else
+            {
+                SmallVector<StringRef, 4> names;
+                StringRef(entry).split(names, ',', -1, false);
+                for (auto name : names)
+                {
+                    entryNames.push_back(name.trim().str());
+                }
+            }
+        }
+        else if (arg == "--seeds")
+        {
+            seedFiles.push_back(nextArg("a file"));
+        }
+        else if (arg == "--diff")
+        {
+            diffFiles.push_back(nextArg("a file"));
+        }
+        else if (arg == "--serve")
+        {
+            serveMode = true;
+        }
+        else if (arg == "--serve-socket")
+        {
+            serveMode = true;
+            serveSocket = nextArg("a socket path");
+        }
+        else if (arg == "--watch")
+        {
+            serveMode = true;
+            watchMode = true;
+        }
+        else
+        {
+            positionals.push_back(arg);
+        }
+    }
+    if (positionals.empty() || (serveMode && (positionals.size() != 1 || !seedFiles.empty() || !diffFiles.empty())))
     {
-        errs() << "Usage: <bcoutput dir> <file:inst_no> [-n]\n";
+        errs() << usage;
         exit(1);
     }
-    commitBCDir = argv[1];
+    commitBCDir = positionals[0];
+    while (commitBCDir.size() > 1 && commitBCDir.back() == '/')
+    {
+        commitBCDir.pop_back();
+    }
 
     std::filesystem::path commitBCPath(commitBCDir);
     if (!std::filesystem::exists(commitBCPath))
@@ -33,467 +178,1624 @@ bool IA::argsHandle(int argc, char **argv)
         exit(1);
     }
 
-    std::string fileInstNo = argv[2];
-    parseFileInstNo(fileInstNo);
-
-    if (argc == 4)
+    // 懒加载时摘要需要物化每个函数体才能得到，没有缓存就失去了懒加载的意义，因此默认启用摘要缓存
+    bool implicitCache = lazyLoad && !useCache;
+    if (implicitCache)
+    {
+        useCache = true;
+    }
+    if (useCache)
     {
-        if (strcmp(argv[3], "-n") != 0)
+        // 缓存默认放在 bcoutput 目录旁边
+        if (cacheDir.empty())
+        {
+            cacheDir = commitBCDir + ".iacache";
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(cacheDir, ec);
+        if (ec && implicitCache)
+        {
+            errs() << "Warning: cannot create cache dir " << cacheDir << ": " << ec.message() << ", function summaries are not cached\n";
+            useCache = false;
+        }
+        else if (ec)
         {
-            errs() << "Usage: <bcoutput dir> <file:inst_no> [-n]\n";
+            errs() << "Error: cannot create cache dir " << cacheDir << ": " << ec.message() << "\n";
             exit(1);
         }
-        flag = false;
     }
-    return flag;
-}
 
-void IA::parseFileInstNo(std::string fileInstNo)
-{
-    std::string fileName;
-    int lineNumber;
-    std::string::size_type pos = fileInstNo.find(':');
-    if (pos != std::string::npos)
-    {
-        fileName = fileInstNo.substr(0, pos);
-        fileName.replace(fileName.find(".c"), 2, ".bc");
-        std::string lineNumberStr = fileInstNo.substr(pos + 1);
-        lineNumber = std::stoi(lineNumberStr);
-    }
-    else
+    if (iCallProfileOnly && iCallProfilePath.empty())
     {
-        errs() << "Error: file:inst_no format error\n";
+        errs() << "Error: --icall-profile-only requires --icall-profile\n";
         exit(1);
     }
-    diffResult[fileName] = lineNumber;
-    std::string workingDir = std::filesystem::current_path();
-    std::string filePath = workingDir + "/result/diff_result.txt";
-    std::ofstream file(filePath);
-    if (!file)
+    if (!iCallProfilePath.empty())
     {
-        file.open(filePath);
+        loadICallProfile();
     }
-    file << fileName << ":" << lineNumber << "\n";
-}
 
-void IA::parseFiles(LLVMContext &context)
-{
-    std::vector<std::string> commitBCPaths;
-    for (const auto &entry : std::filesystem::directory_iterator(commitBCDir))
+    if (serveMode)
     {
-        std::string filePath = entry.path().string();
-        if (filePath.find(".bc") != std::string::npos)
+        return flag;
+    }
+    for (size_t i = 1; i < positionals.size(); i++)
+    {
+        if (!parseFileInstNo(positionals[i]))
         {
-            commitBCPaths.push_back(filePath);
+            errs() << "Error: file:inst_no format error: " << positionals[i] << "\n";
+            exit(1);
         }
     }
-    for (const auto &filePath : commitBCPaths)
+    for (auto &seedFile : seedFiles)
     {
-        SMDiagnostic error;
-        auto module = parseIRFile(filePath, error, context);
-        if (!module)
+        if (!parseSeedFile(seedFile))
         {
-            errs() << "Error: failed to load " << filePath << "\n";
             exit(1);
         }
-        else
+    }
+    for (auto &diffFile : diffFiles)
+    {
+        if (!parseUnifiedDiff(diffFile))
         {
-            // errs() << "Successfully loaded " << filePath << "\n";
+            exit(1);
         }
-        commitBCModules.push_back(std::move(module));
     }
-
-    errs() << "commitBCModules: " << commitBCModules.size() << "\n";
-
-    for (const auto &module : commitBCModules)
+    if (diffResult.empty())
     {
-        for (auto &function : *module)
+        if (!diffFiles.empty())
         {
-            if (function.getName().str().find("llvm.dbg.declare") != std::string::npos)
-            {
-                continue;
-            }
-            commitBCFunctions.push_back(&function);
+            // diff 中没有改动 C/C++ 源文件，不需要分析；仍然写出空的结果，避免下游读到上一次运行的结果
+            std::cout << "No changed C/C++ source lines in the diff\n";
+            writeDiffResult();
+            writeFinalResult();
+            exit(0);
         }
+        errs() << usage;
+        exit(1);
     }
-    // errs() << "commitOneFunctions: " << commitOneFunctions.size() << "\n";
-    // errs() << "commitTwoFunctions: " << commitTwoFunctions.size() << "\n";
-    errs() << "commitBCFunctions: " << commitBCFunctions.size() << "\n";
+    writeDiffResult();
+    return flag;
 }
 
-void IA::compareChanges()
+// 每行一个 file:inst_no，忽略空行和 # 开头的注释，"-" 表示从标准输入读取
+bool IA::parseSeedFile(std::string seedFile)
 {
-    for (auto &i : diffResult)
+    std::ifstream file;
+    if (seedFile != "-")
     {
-        std::string fileName = i.first;
-        int lineNumbers = i.second;
-        setOriginalFile(fileName);
-        setOriginalLine(lineNumbers);
-        for (auto &module : commitBCModules)
+        file.open(seedFile);
+        if (!file)
         {
-            std::string moduleName = module->getName().str();
-            std::string moduleFileName = moduleName.substr(moduleName.find_last_of('/') + 1);
-            if (moduleFileName == fileName)
-            {
-                for (auto &function : *module)
-                {
-                    std::string functionName = function.getName().str();
-                    for (auto &bb : function)
-                    {
-                        for (auto &inst : bb)
-                        {
-                            DILocation *loc = inst.getDebugLoc();
-                            if (!loc)
-                            {
-                                continue;
-                            }
-                            unsigned line = loc->getLine();
-                            if (lineNumbers == line)
-                            {
-                                errs() << "Changed Instruction: " << inst << "\n";
-                                changedInstructions.push_back(&inst);
-                            }
-                        }
-                    }
-                }
-            }
+            errs() << "Error: cannot open seed file " << seedFile << "\n";
+            return false;
         }
     }
-}
-
-llvm::Function *IA::getChangedFunction(llvm::Module &module, const std::string fileName, std::string funcName)
-{
-    std::string moduleName = module.getName().str();
-    std::string moduleFileName = moduleName.substr(moduleName.find_last_of('/') + 1);
-    if (moduleFileName == fileName)
+    std::istream &in = seedFile == "-" ? std::cin : file;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line))
     {
-        for (auto &f : module)
+        lineNo++;
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#')
         {
-            if (f.getName().str() == funcName)
-            {
-                // llvm::errs() << "Found function: " << f.getName() << "\n";
-                return &f;
-            }
+            continue;
+        }
+        if (!parseFileInstNo(line))
+        {
+            errs() << "Error: file:inst_no format error at " << seedFile << ":" << lineNo << ": " << line << "\n";
+            return false;
         }
     }
-    return nullptr;
+    return true;
 }
 
-void IA::getAllGVs()
+// 读取统一格式的 diff（如 git diff 的输出），"-" 表示从标准输入读取
+// .c 与 .h 文件中新增的行直接作为种子；被删除的行已不在新版本中，映射到其后第一行保留下来的行，
+// 若删除位于 hunk 末尾则映射到其前一行
+bool IA::parseUnifiedDiff(std::string diffFile)
 {
-    std::cout << "Get All Global Variables" << std::endl;
-    for (auto &module : commitBCModules)
+    std::ifstream file;
+    if (diffFile != "-")
     {
-        // errs() << "Module: " << module->getSourceFileName() << "\n";
-        for (auto &gv : module->globals())
+        file.open(diffFile);
+        if (!file)
         {
-            // errs() << "Global Variable: " << gv.getName() << "\n";
-            // errs() << "In Module: " << gv.getParent()->getName() << "\n";
-            // errs() << "Uses of this gv:" << gv.getNumUses() << "\n";
-            // for (auto &use : gv.uses())
-            // {
-            //     errs() << "Use: " << *use.getUser() << "\n";
-            // }
-            // errs() << "--------------------------------------" << "\n";
-            globalVariables.push_back(&gv);
+            errs() << "Error: cannot open diff file " << diffFile << "\n";
+            return false;
         }
     }
-    for (auto &gv : globalVariables)
+    std::istream &in = diffFile == "-" ? std::cin : file;
+    std::regex hunkHeader(R"(^@@ -\d+(?:,(\d+))? \+(\d+)(?:,(\d+))? @@)");
+    std::string line;
+    std::string fileName; // 当前文件对应的 .c 文件名，不是 .c 文件时为空
+    int newLine = 0;      // 新版本中下一行的行号
+    int newRemaining = 0; // 当前 hunk 中新版本还剩余的行数
+    int oldRemaining = 0; // 当前 hunk 中旧版本还剩余的行数
+    bool pendingRemoval = false;
+    size_t seedCount = diffResult.size();
+
+    auto addSeed = [&](int lineNumber)
     {
-        std::vector<Instruction *> uses;
-        for (auto &use : gv->uses())
+        if (!fileName.empty() && lineNumber > 0)
         {
-            // errs() << "Use: " << *use.getUser() << "\n";
-            if (auto *inst = dyn_cast<Instruction>(use.getUser()))
-            {
-                uses.push_back(inst);
-            }
-            else
-            {
-                // errs() << "Error: use " << *use << " is not an instruction\n ";
-            }
+            parseFileInstNo(fileName + ":" + std::to_string(lineNumber));
         }
-        GlobalVariableInfo gvInfo = GlobalVariableInfo(gv, uses);
-        globalVariableInfos.push_back(gvInfo);
-    }
-    std::cout << "Global Variables: " << globalVariables.size() << std::endl;
-}
-
-std::string IA::removeStructVersionNumber(const std::string &inst)
-{
-    std::string result;
-    size_t lastPos = 0;
-    size_t structPos = inst.find("%struct.", lastPos);
-
-    while (structPos != std::string::npos)
+    };
+    auto endHunk = [&]()
     {
-        result += inst.substr(lastPos, structPos - lastPos);
-        size_t start = structPos + 8;
-        size_t end = start;
-        while (end < inst.length() && (isalnum(inst[end]) || inst[end] == '_'))
+        if (pendingRemoval)
         {
-            end++;
+            addSeed(newLine - 1);
+            pendingRemoval = false;
         }
+        newRemaining = 0;
+        oldRemaining = 0;
+    };
 
-        size_t versionStart = inst.find('.', end);
-        if (versionStart != std::string::npos)
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
         {
-            size_t versionEnd = versionStart + 1;
-            while (versionEnd < inst.length() && isdigit(inst[versionEnd]))
+            line.pop_back();
+        }
+        if (newRemaining > 0 || oldRemaining > 0)
+        {
+            char tag = line.empty() ? ' ' : line[0];
+            if (tag == '+')
             {
-                versionEnd++;
+                addSeed(newLine);
+                pendingRemoval = false;
+                newLine++;
+                newRemaining--;
             }
-            if (versionEnd != versionStart + 1)
+            else if (tag == '-')
             {
-                result += inst.substr(structPos, versionStart - structPos);
-                lastPos = versionEnd;
+                pendingRemoval = true;
+                oldRemaining--;
             }
-            else
+            else if (tag == ' ')
             {
-                result += inst.substr(structPos, end - structPos);
-                lastPos = end;
+                if (pendingRemoval)
+                {
+                    addSeed(newLine);
+                    pendingRemoval = false;
+                }
+                newLine++;
+                newRemaining--;
+                oldRemaining--;
+            }
+            // "\ No newline at end of file" 不占行号
+            if (newRemaining <= 0 && oldRemaining <= 0)
+            {
+                endHunk();
             }
+            continue;
         }
-        else
+
+        std::smatch match;
+        if (line.compare(0, 4, "+++ ") == 0)
         {
-            result += inst.substr(structPos, end - structPos);
-            lastPos = end;
+            endHunk();
+            std::string path = line.substr(4);
+            path = path.substr(0, path.find('\t'));
+            // 模块按文件名匹配，去掉 a/ b/ 前缀以及目录
+            path = path.substr(path.find_last_of('/') + 1);
+            std::string::size_type extPos = path.rfind('.');
+            std::string ext = extPos == std::string::npos ? "" : path.substr(extPos);
+            static const std::set<std::string> sourceExts = {".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx"};
+            fileName = sourceExts.count(ext) ? path : "";
+            if (fileName.empty() && path != "null")
+            {
+                errs() << "Warning: skipping the hunks of " << path << " (not a C/C++ source file)\n";
+            }
+        }
+        else if (std::regex_search(line, match, hunkHeader))
+        {
+            endHunk();
+            oldRemaining = match[1].matched ? std::stoi(match[1]) : 1;
+            newLine = std::stoi(match[2]);
+            newRemaining = match[3].matched ? std::stoi(match[3]) : 1;
+            // 新版本行数为 0 时起始行号指向被删除片段之前的那一行
+            if (newRemaining == 0)
+            {
+                newLine++;
+            }
         }
-
-        structPos = inst.find("%struct.", lastPos);
     }
+    endHunk();
+    std::cout << "Seeds from " << diffFile << ": " << diffResult.size() - seedCount << "\n";
+    return true;
+}
 
-    result += inst.substr(lastPos);
-
-    size_t debugPos = result.find(", !dbg !");
-    if (debugPos != std::string::npos)
+void IA::writeDiffResult()
+{
+    std::string workingDir = std::filesystem::current_path();
+    std::string filePath = workingDir + "/result/diff_result.txt";
+    std::ofstream file(filePath);
+    for (auto &seed : diffResult)
     {
-        result = result.substr(0, debugPos);
+        file << seed.first << ":" << seed.second << "\n";
     }
+}
 
-    return result;
+bool IA::parseFileInstNo(std::string fileInstNo)
+{
+    std::string fileName;
+    int lineNumber;
+    std::string::size_type pos = fileInstNo.find(':');
+    if (pos == std::string::npos)
+    {
+        return false;
+    }
+    fileName = fileInstNo.substr(0, pos);
+    std::string::size_type extPos = fileName.rfind('.');
+    if (extPos == std::string::npos)
+    {
+        return false;
+    }
+    // .c 文件沿用 diff_result.txt 中的 .bc 写法，头文件等保持原名
+    if (fileName.compare(extPos, std::string::npos, ".c") == 0)
+    {
+        fileName.replace(extPos, 2, ".bc");
+    }
+    try
+    {
+        lineNumber = std::stoi(fileInstNo.substr(pos + 1));
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+    std::pair<std::string, int> seed(fileName, lineNumber);
+    if (std::find(diffResult.begin(), diffResult.end(), seed) == diffResult.end())
+    {
+        diffResult.push_back(seed);
+    }
+    return true;
 }
 
-void IA::callAnalyze(CallInst *callStatement)
+// 读取并解析一个 .bc 文件；懒加载时只读取模块级信息，函数体逐个物化生成摘要后立即丢弃；
+// 启用缓存时命中的模块直接读取摘要。会被多个加载线程同时调用，只读取配置项
+std::unique_ptr<Module> IA::loadModuleFile(const std::string &path, LLVMContext &context, std::vector<std::pair<Function *, FunctionSummary>> &summaries, std::string &hash, bool &cacheHit)
 {
-    if (auto *CI = dyn_cast<CallInst>(callStatement))
+    SMDiagnostic error;
+    std::unique_ptr<Module> loadedModule;
+    // 懒加载的模块在整个运行期间都会从缓冲区读取函数体，监视模式下文件可能被原地改写，此时不使用 mmap
+    auto buffer = openBitcodeFile(path, lazyLoad && watchMode, ioStats);
+    if (!buffer)
     {
-        if (CI->isInlineAsm())
+        return nullptr;
+    }
+    hash = getContentHash((*buffer)->getBuffer());
+    if (lazyLoad)
+    {
+        loadedModule = getLazyIRModule(std::move(*buffer), error, context);
+    }
+    else
+    {
+        loadedModule = parseIR((*buffer)->getMemBufferRef(), error, context);
+    }
+    if (!loadedModule || (!lazyLoad && !useCache))
+    {
+        return loadedModule;
+    }
+    std::string cachePath = cacheDir + "/" + hash + ".iacache";
+    if (useCache && readModuleCache(cachePath, *loadedModule, summaries))
+    {
+        cacheHit = true;
+        return loadedModule;
+    }
+    summaries.clear();
+    for (auto &function : *loadedModule)
+    {
+        if (lazyLoad && function.isMaterializable())
         {
-            // asmCalls.push_back(CI);
-            // errs() << "Asm call: " << *CI << "\n";
-            // errs() << "Asm call Function name: " << CI->getParent()->getName() << "\n";
+            if (Error err = function.materialize())
+            {
+                consumeError(std::move(err));
+                return nullptr;
+            }
+            summaries.emplace_back(&function, summarizeFunction(function));
+            dropFunctionBody(function);
         }
-        else if (CI->isIndirectCall() == true)
+        else if (!lazyLoad && !function.isDeclaration())
         {
-            indirectCalls.push_back(CI);
-            // errs() << "Indirect call: " << *CI << "\n";
-            // errs() << "Indirect call Function name: " << CI->getParent()->getName() << "\n";
+            summaries.emplace_back(&function, summarizeFunction(function));
         }
-        else if (CI->getCalledFunction() == nullptr)
-        {
-            indirectCalls.push_back(CI);
-            // errs() << "Indirect call: " << *CI << "\n";
-            // errs() << "Indirect call Function name: " << CI->getParent()->getName() << "\n";
+    }
+    if (useCache)
+    {
+        writeModuleCache(cachePath, *loadedModule, summaries);
+    }
+    return loadedModule;
+}
+
+// 去掉 IR 文本中每个 % 开头的名字上共享 LLVMContext 追加的 .N 后缀
+static std::string stripTypeVersions(const std::string &text)
+{
+    std::string stripped;
+    stripped.reserve(text.size());
+    for (size_t i = 0; i < text.size();)
+    {
+        if (text[i] != '%')
+        {
+            stripped += text[i++];
+            continue;
         }
-        else
+        size_t end = i + 1;
+        while (end < text.size() && (isalnum(static_cast<unsigned char>(text[end])) || text[end] == '.' || text[end] == '_'))
         {
-            directCalls.push_back(CI);
-            // errs() << "Direct call: " << *CI << "\n";
-            // errs() << "Direct call Function name: " << CI->getParent()->getName() << "\n";
-            if (CI->getCalledFunction())
+            end++;
+        }
+        stripped += stripTypeVersion(StringRef(text).slice(i, end)).str();
+        i = end;
+    }
+    return stripped;
+}
+
+// 函数体的哈希：每条指令的操作码、类型、比较谓词、操作数与行号。
+// 函数内的值按出现顺序编号，不依赖值的名字；元数据（包括 !dbg 中的文件路径）不参与；
+// 文本中 % 开头的只有类型名，去掉共享 LLVMContext 追加的 .N 后缀
+std::string getFunctionBodyHash(Function &function)
+{
+    std::unordered_map<const Value *, unsigned> localIds;
+    for (auto &arg : function.args())
+    {
+        localIds.emplace(&arg, localIds.size());
+    }
+    for (auto &bb : function)
+    {
+        localIds.emplace(&bb, localIds.size());
+        for (auto &inst : bb)
+        {
+            localIds.emplace(&inst, localIds.size());
+        }
+    }
+    std::string body;
+    llvm::raw_string_ostream os(body);
+    for (auto &inst : instructions(function))
+    {
+        os << inst.getOpcodeName() << " ";
+        inst.getType()->print(os);
+        if (auto *cmp = dyn_cast<CmpInst>(&inst))
+        {
+            os << " " << CmpInst::getPredicateName(cmp->getPredicate());
+        }
+        for (Value *operand : inst.operands())
+        {
+            auto local = localIds.find(operand);
+            if (local != localIds.end())
             {
-                // errs() << "Direct call target: " << CI->getCalledFunction()->getName() << "\n";
+                os << " %" << local->second;
             }
-            else
+            else if (!isa<MetadataAsValue>(operand))
             {
-                // errs() << "Direct call target: Indirect call or target not available\n";
+                os << " ";
+                operand->printAsOperand(os, true, function.getParent());
             }
         }
+        DILocation *loc = inst.getDebugLoc();
+        os << " @" << (loc ? loc->getLine() : 0) << "\n";
     }
+    os.flush();
+    return getContentHash(stripTypeVersions(body));
 }
 
-void IA::analyzeAllCallInsts()
+// 模块的指纹：源文件名、每个有定义的全局变量的名字、链接属性与初值哈希，加上每个有定义的函数的名字与函数体哈希。
+// 同一源文件只是路径、调试信息等不同的模块内容哈希不同，但指纹相同；只有数据不同（如不同 -D 编译出的常量表、虚表）的不同。
+// 懒加载时函数体已被丢弃，改用摘要中记录的函数体哈希
+std::string getModuleFingerprint(Module &module, const std::vector<std::pair<Function *, FunctionSummary>> &summaries)
 {
-    std::cout << "Analyze All Call Insts" << std::endl;
-    std::vector<Instruction *> indirectCalls;
-    for (auto &module : commitBCModules)
+    std::unordered_map<Function *, const FunctionSummary *> summaryOf;
+    for (auto &summary : summaries)
     {
-        for (auto &function : *module)
+        summaryOf[summary.first] = &summary.second;
+    }
+    std::string fingerprint;
+    llvm::raw_string_ostream os(fingerprint);
+    os << module.getSourceFileName() << "\n";
+    for (auto &gv : module.globals())
+    {
+        if (gv.isDeclaration())
         {
-            for (auto &bb : function)
-            {
-                for (auto &inst : bb)
-                {
-                    if (auto callInst = dyn_cast<CallInst>(&inst))
-                    {
-                        // errs() << "CallInst: " << *callInst << "\n";
-
-                        std::string instStr;
-                        llvm::raw_string_ostream rso(instStr);
-                        callInst->print(rso);
-                        rso.flush();
-                        if (instStr.find("call void @llvm.dbg.declare(") != std::string::npos)
-                        {
-                            continue;
-                        }
-                        callAnalyze(callInst);
-                    }
-                }
-            }
+            continue;
+        }
+        std::string initializer;
+        llvm::raw_string_ostream initializerOs(initializer);
+        gv.getInitializer()->print(initializerOs);
+        initializerOs.flush();
+        os << gv.getName() << ":" << gv.getLinkage() << ":" << getContentHash(stripTypeVersions(initializer)) << "\n";
+    }
+    for (auto &function : module)
+    {
+        if (function.isDeclaration())
+        {
+            continue;
         }
+        os << function.getName() << ":";
+        if (!function.empty())
+        {
+            os << getFunctionBodyHash(function);
+        }
+        else if (summaryOf.count(&function))
+        {
+            os << summaryOf[&function]->bodyHash;
+        }
+        os << "\n";
     }
+    os.flush();
+    return getContentHash(fingerprint);
 }
 
-// 传入一个 llvm 函数，返回该函数的所有参数类型
-std::vector<Type *> getFuncParameterTypes(Function *function)
+// 返回已加载的模块中与之内容相同、或源文件与函数指纹相同的模块路径，不存在时返回空串
+std::string IA::findDuplicateModule(const std::string &hash, const std::string &fingerprint, const std::string &ignoredPath)
 {
-    std::vector<Type *> parameterTypes;
-    if (!function)
+    auto byHash = moduleByHash.find(hash);
+    if (byHash != moduleByHash.end() && byHash->second != ignoredPath)
     {
-        return parameterTypes; // 如果传入的函数为空，则返回空列表
+        return byHash->second;
     }
-
-    for (auto &arg : function->args())
+    auto byFingerprint = moduleByFingerprint.find(fingerprint);
+    if (byFingerprint != moduleByFingerprint.end() && byFingerprint->second != ignoredPath)
     {
-        parameterTypes.push_back(arg.getType());
+        return byFingerprint->second;
     }
+    return "";
+}
 
-    return parameterTypes;
+// 记录新保留的模块的路径、内容哈希与指纹
+void IA::recordModulePath(const std::string &path, const std::string &hash, const std::string &fingerprint)
+{
+    modulePaths.push_back(path);
+    moduleHashes.push_back(hash);
+    moduleFingerprints.push_back(fingerprint);
+    moduleByHash.emplace(hash, path);
+    moduleByFingerprint.emplace(fingerprint, path);
 }
 
-// 将 IA 类中的所有 indirectCallInfos 转换为 functionCaller
-void IA::parseICallInfos()
+void IA::parseFiles(LLVMContext &context)
 {
-    // 首先遍历所有的 iCallInfos
-    for (auto &info : iCallInfos)
+    auto start = std::chrono::high_resolution_clock::now();
+    mainContext = &context;
+    std::vector<std::string> commitBCPaths;
+    for (const auto &entry : std::filesystem::directory_iterator(commitBCDir))
     {
-        // 获取其 callStatement
-        Instruction *inst = info.getCallInst();
-        // 获取其可能的 possibleCallees
-        std::vector<Function *> possibleCallees = info.getPossibleCallees();
+        std::string filePath = entry.path().string();
+        if (filePath.find(".bc") != std::string::npos)
+        {
+            commitBCPaths.push_back(filePath);
+        }
+    }
+    // directory_iterator 的顺序不固定，排序后重复模块中保留哪一份是确定的
+    std::sort(commitBCPaths.begin(), commitBCPaths.end());
+    prefetchBitcodeFiles(commitBCPaths, ioStats);
 
-        // 遍历所有的 possibleCallees
-        for (auto &callee : possibleCallees)
+    // 每个 worker 使用独立的 LLVMContext，结果按原目录顺序放回，后续分析看到的模块集合与顺序不变
+    size_t workers = std::min<size_t>(jobs, commitBCPaths.size());
+    std::vector<std::unique_ptr<llvm::Module>> loadedModules(commitBCPaths.size());
+    std::vector<LLVMContext *> contexts{&context};
+    for (size_t w = 1; w < workers; w++)
+    {
+        workerContexts.push_back(std::make_unique<LLVMContext>());
+        contexts.push_back(workerContexts.back().get());
+    }
+
+    std::vector<std::vector<std::pair<Function *, FunctionSummary>>> loadedSummaries(commitBCPaths.size());
+    std::vector<std::string> loadedHashes(commitBCPaths.size());
+    std::vector<std::string> loadedFingerprints(commitBCPaths.size());
+    std::atomic<size_t> cacheHits{0};
+    // 每个 worker 负责连续的一段文件，同一 context 中的模块与加载顺序固定，结构体类型的 .N 后缀在多次运行之间保持一致
+    auto loadWorker = [&](size_t worker, LLVMContext *workerContext)
+    {
+        size_t workerCount = std::max<size_t>(workers, 1);
+        size_t first = commitBCPaths.size() * worker / workerCount;
+        size_t last = commitBCPaths.size() * (worker + 1) / workerCount;
+        for (size_t i = first; i < last; i++)
         {
-            // 首先检查 callee 是否为空
-            if (!callee)
+            bool cacheHit = false;
+            loadedModules[i] = loadModuleFile(commitBCPaths[i], *workerContext, loadedSummaries[i], loadedHashes[i], cacheHit);
+            if (cacheHit)
             {
-                continue;
+                cacheHits++;
             }
-            // 然后检查在 functionCallers 中是否已经存在该 callee
-            bool found = false;
-            for (auto &caller : functionCallers)
+            if (loadedModules[i])
             {
-                if (caller.getFunction() == callee)
-                {
-                    // 如果找到，则将 inst 加入到该 caller 的 callStatements 中
-                    caller.addPossibleCaller(inst);
-                    found = true;
-                    break;
-                }
+                loadedFingerprints[i] = getModuleFingerprint(*loadedModules[i], loadedSummaries[i]);
             }
-            // 如果没有找到，则创建一个新的 functionCaller
-            if (!found)
+        }
+    };
+    if (workers <= 1)
+    {
+        loadWorker(0, &context);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < contexts.size(); w++)
+        {
+            threads.emplace_back(loadWorker, w, contexts[w]);
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    size_t duplicates = 0;
+    for (size_t i = 0; i < commitBCPaths.size(); i++)
+    {
+        if (!loadedModules[i])
+        {
+            errs() << "Error: failed to load " << commitBCPaths[i] << "\n";
+            exit(1);
+        }
+        // 同一源文件被编译多次（如静态库与动态库各一份）时只保留第一份
+        std::string duplicateOf = findDuplicateModule(loadedHashes[i], loadedFingerprints[i], "");
+        if (!duplicateOf.empty())
+        {
+            errs() << "Skipping duplicate module " << commitBCPaths[i] << " (same as " << duplicateOf << ")\n";
+            skippedDuplicates[commitBCPaths[i]] = duplicateOf;
+            loadedModules[i].reset();
+            duplicates++;
+            continue;
+        }
+        commitBCModules.push_back(std::move(loadedModules[i]));
+        recordModulePath(commitBCPaths[i], loadedHashes[i], loadedFingerprints[i]);
+        linkModuleSymbols(*commitBCModules.back());
+        for (auto &summary : loadedSummaries[i])
+        {
+            addFunctionSummary(summary.first, std::move(summary.second));
+        }
+    }
+    updateProgramHash();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    errs() << "Load time: " << elapsed.count() << " s (" << std::max<size_t>(workers, 1) << " jobs)\n";
+    printBitcodeIOStats(ioStats);
+    if (useCache)
+    {
+        errs() << "Cache hits: " << cacheHits << "/" << commitBCPaths.size() << " (" << cacheDir << ")\n";
+    }
+
+    if (duplicates)
+    {
+        errs() << "Duplicate modules skipped: " << duplicates << "/" << commitBCPaths.size() << "\n";
+    }
+    errs() << "commitBCModules: " << commitBCModules.size() << "\n";
+
+    for (const auto &module : commitBCModules)
+    {
+        for (auto &function : *module)
+        {
+            if (function.getName().str().find("llvm.dbg.declare") != std::string::npos)
             {
-                FunctionCaller caller(callee);
-                caller.addPossibleCaller(inst);
-                functionCallers.push_back(caller);
+                continue;
             }
+            commitBCFunctions.push_back(&function);
+            indexLines(function);
+            numberInstructions(function);
         }
     }
-    // 打印 functionCallers
-    // for (auto &caller : functionCallers)
-    // {
-    //     errs() << "Function: " << caller.getFunction()->getName() << "\n";
-    //     errs() << "Callers: \n";
-    //     for (auto &inst : caller.getPossibleCallers())
-    //     {
-    //         errs() << *inst << "\n";
-    //     }
-    //     errs() << "--------------------------------------" << "\n";
-    // }
+    // errs() << "commitOneFunctions: " << commitOneFunctions.size() << "\n";
+    // errs() << "commitTwoFunctions: " << commitTwoFunctions.size() << "\n";
+    errs() << "commitBCFunctions: " << commitBCFunctions.size() << "\n";
+    computeEntryReachability();
 }
 
-// 然后处理所有的 直接调用，将其转换为 functionCaller
-void IA::parseDirectCalls()
+// 整个程序的哈希，用于缓存依赖所有模块的结果（间接调用的候选函数）；候选还取决于入口
+void IA::updateProgramHash()
 {
-    for (auto &inst : directCalls)
+    std::string input = llvm::join(moduleHashes, ",");
+    if (!entryNames.empty())
     {
-        // 将 callInst 转换为 CallInst
-        CallInst *callInst = dyn_cast<CallInst>(inst);
-        Function *callee = callInst->getCalledFunction();
-        if (!callInst)
+        input += "\nentry:" + llvm::join(entryNames, ",");
+    }
+    programHash = getContentHash(input);
+}
+
+// 从入口函数出发求出可能执行的函数（类似 RTA）：直接调用的函数、函数体中取了地址的函数，
+// 以及函数体引用的全局变量的初始值中（逐层）出现的函数；构造/析构函数与 llvm.used 同样作为入口
+// 懒加载时函数体已丢弃，使用摘要中记录的调用与引用
+void IA::computeEntryReachability()
+{
+    if (entryNames.empty())
+    {
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<Function *>> definitions(functionCallers.size()); // 规范 ID -> 定义
+    for (auto &module : commitBCModules)
+    {
+        for (auto &function : *module)
         {
-            continue;
+            if (!function.isDeclaration())
+            {
+                definitions[assignFunctionId(&function)].push_back(&function);
+            }
+        }
+    }
+    entryLive.assign(functionCallers.size(), 0);
+    std::vector<char> globalSeen(linkedGlobals.size(), 0);
+    std::vector<Function *> worklist;
+    std::vector<Value *> operands;
+    auto markFunction = [&](Function *function)
+    {
+        unsigned id = assignFunctionId(function);
+        if (id >= entryLive.size())
+        {
+            entryLive.resize(id + 1, 0);
+            definitions.resize(id + 1);
+        }
+        if (!entryLive[id])
+        {
+            entryLive[id] = 1;
+            worklist.insert(worklist.end(), definitions[id].begin(), definitions[id].end());
+        }
+    };
+    auto markGlobal = [&](GlobalVariable *gv)
+    {
+        unsigned id = assignGlobalId(gv);
+        if (id >= globalSeen.size())
+        {
+            globalSeen.resize(id + 1, 0);
         }
+        if (globalSeen[id])
+        {
+            return;
+        }
+        globalSeen[id] = 1;
+        for (GlobalVariable *linked : linkedGlobals[id])
+        {
+            if (linked->hasInitializer())
+            {
+                operands.push_back(linked->getInitializer());
+            }
+        }
+    };
+    for (auto &name : entryNames)
+    {
         bool found = false;
-        for (auto &caller : functionCallers)
+        for (auto &module : commitBCModules)
         {
-            if (caller.getFunction() == callee)
+            Function *function = module->getFunction(name);
+            if (function && !function->isDeclaration())
             {
-                caller.addPossibleCaller(callInst);
+                markFunction(function);
                 found = true;
-                break;
             }
         }
         if (!found)
         {
-            FunctionCaller caller(callee);
-            caller.addPossibleCaller(callInst);
-            functionCallers.push_back(caller);
+            errs() << "Warning: entry function not found: " << name << "\n";
         }
     }
-    // 打印 functionCallers
-    // for (auto &caller : functionCallers)
-    // {
-    //     errs() << "Function: " << caller.getFunction()->getName() << "\n";
-    //     errs() << "Callers: \n";
-    //     for (auto &inst : caller.getPossibleCallers())
-    //     {
-    //         errs() << *inst << "\n";
-    //     }
-    //     errs() << "--------------------------------------" << "\n";
-    // }
-}
-
-// 当检查完所有的 impact 之后，我们需要对所有的 IA 类中的 IMPACT 对象进行分析，获取其原代码行号
-void IA::parseSourceLine()
-{
-    int noLocInsts = 0;
-    std::cout << "Parse Source Line informations" << std::endl;
-    // 创建一个 SourceLineInfo 对象
-    SourceLineInfo sli(originalFile, originalLine);
-
-    // 遍历所有的 impact 对象
-    std::cout << "Impacts size: " << impacts.size() << std::endl;
-    for (auto &impact : impacts)
+    for (auto &module : commitBCModules)
     {
-        // 将每个 impact 的受影响的指令添加到 SourceLineInfo 对象中
-        for (auto &inst : impact.getImpactedInsts())
+        for (const char *name : {"llvm.global_ctors", "llvm.global_dtors", "llvm.used", "llvm.compiler.used"})
         {
-            // errs() << "Impacted Instruction: " << *inst << "\n";
-            Instruction *impactedInst = dyn_cast<Instruction>(inst);
-            // 确保 impactedInst 不为空
-            if (!impactedInst)
+            if (GlobalVariable *gv = module->getNamedGlobal(name))
             {
-                // errs() << "Error: impactedInst is null\n";
-                continue;
+                markGlobal(gv);
             }
-            // 获取 impactedInst 的 debug location
-            DILocation *loc = impactedInst->getDebugLoc();
-            // 确保 loc 不为空
-            if (!loc)
+        }
+    }
+    while (!worklist.empty() || !operands.empty())
+    {
+        if (operands.empty())
+        {
+            Function *function = worklist.back();
+            worklist.pop_back();
+            auto summary = functionSummaries.find(function);
+            if (summary != functionSummaries.end())
             {
-                noLocInsts++;
-                // errs() << "Error: loc is null\n";
+                for (auto &callee : summary->second.directCallees)
+                {
+                    if (Function *calleeFunction = function->getParent()->getFunction(callee))
+                    {
+                        markFunction(calleeFunction);
+                    }
+                }
+                for (auto *addressTaken : summary->second.addressTakenFunctions)
+                {
+                    markFunction(addressTaken);
+                }
+                for (auto *gv : summary->second.globalVariables)
+                {
+                    markGlobal(gv);
+                }
                 continue;
             }
-            unsigned line = loc->getLine();
-            // errs() << "Impacted Instruction Line: " << line << "\n";
-            std::string fileName = loc->getFilename().str();
-            // errs() << "Impacted Instruction File: " << fileName << "\n";
-            sli.addImpactedInst(fileName, line);
+            for (auto &inst : instructions(*function))
+            {
+                for (auto &operand : inst.operands())
+                {
+                    if (isa<Constant>(operand.get()))
+                    {
+                        operands.push_back(operand.get());
+                    }
+                }
+            }
+            continue;
+        }
+        Value *operand = operands.back();
+        operands.pop_back();
+        if (auto *function = dyn_cast<Function>(operand))
+        {
+            markFunction(function);
+        }
+        else if (auto *gv = dyn_cast<GlobalVariable>(operand))
+        {
+            markGlobal(gv);
+        }
+        else if (auto *alias = dyn_cast<GlobalAlias>(operand))
+        {
+            operands.push_back(alias->getAliasee());
+        }
+        else if (isa<ConstantExpr>(operand) || isa<ConstantAggregate>(operand))
+        {
+            operands.insert(operands.end(), cast<User>(operand)->op_begin(), cast<User>(operand)->op_end());
+        }
+    }
+    size_t defined = 0;
+    size_t live = 0;
+    for (size_t id = 0; id < definitions.size(); id++)
+    {
+        if (!definitions[id].empty())
+        {
+            defined++;
+            live += entryLive[id];
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    errs() << "Entry reachability: " << live << "/" << defined << " functions reachable from " << entryNames.size() << " entries (" << elapsed.count() << " s)\n";
+}
+
+// 没有指定入口时不裁剪；计算之后新出现的函数也不裁剪，等下一次计算
+bool IA::isPruned(Function *function) const
+{
+    if (entryNames.empty())
+    {
+        return false;
+    }
+    auto it = functionIds.find(function);
+    return it != functionIds.end() && it->second < entryLive.size() && !entryLive[it->second];
+}
+
+// 源文件在索引中的键：去掉目录，种子中的 .bc 还原为 .c
+static std::string getSourceFileKey(std::string fileName)
+{
+    fileName = fileName.substr(fileName.find_last_of('/') + 1);
+    if (fileName.size() > 3 && fileName.compare(fileName.size() - 3, 3, ".bc") == 0)
+    {
+        fileName.replace(fileName.size() - 3, 3, ".c");
+    }
+    return fileName;
+}
+
+// 按 DILocation 的文件与行号索引函数中的指令；内联或宏展开进来的头文件行
+// 记在头文件名下，因此一个头文件的行会对应到所有包含它的模块
+void IA::indexLines(Function &function)
+{
+    for (auto &inst : instructions(function))
+    {
+        if (DILocation *loc = inst.getDebugLoc())
+        {
+            lineIndex[getSourceFileKey(loc->getFilename().str())][loc->getLine()].push_back(&inst);
+        }
+    }
+}
+
+void IA::unindexLines(Function &function)
+{
+    for (auto &inst : instructions(function))
+    {
+        DILocation *loc = inst.getDebugLoc();
+        if (!loc)
+        {
+            continue;
+        }
+        auto file = lineIndex.find(getSourceFileKey(loc->getFilename().str()));
+        if (file == lineIndex.end())
+        {
+            continue;
+        }
+        auto line = file->second.find(loc->getLine());
+        if (line == file->second.end())
+        {
+            continue;
+        }
+        auto &insts = line->second;
+        insts.erase(std::remove(insts.begin(), insts.end(), &inst), insts.end());
+        if (insts.empty())
+        {
+            file->second.erase(line);
+        }
+    }
+}
+
+// 函数体中的指令取得连续的编号；没有函数体（声明或尚未物化）时不编号
+void IA::numberInstructions(Function &function)
+{
+    if (function.empty())
+    {
+        return;
+    }
+    unsigned count = function.getInstructionCount();
+    auto range = instructionRanges.find(&function);
+    if (range == instructionRanges.end() || range->second.second != count)
+    {
+        range = instructionRanges.insert_or_assign(&function, std::make_pair(instructionIdCount, count)).first;
+        instructionIdCount += count;
+    }
+    unsigned id = range->second.first;
+    for (auto &inst : instructions(function))
+    {
+        instructionIds[&inst] = id++;
+    }
+}
+
+void IA::unnumberInstructions(Function &function)
+{
+    dataFlowUses.erase(&function);
+    controlDependences.erase(&function);
+    iCallSiteOrdinals.erase(&function);
+    for (auto &inst : instructions(function))
+    {
+        instructionIds.erase(&inst);
+    }
+}
+
+const std::vector<Instruction *> &IA::getDataFlowUses(Function *function)
+{
+    auto it = dataFlowUses.find(function);
+    if (it == dataFlowUses.end())
+    {
+        it = dataFlowUses.emplace(function, std::vector<Instruction *>()).first;
+        collectDataFlowUses(*function, it->second);
+    }
+    return it->second;
+}
+
+const std::vector<BasicBlock *> &IA::getControlDependentBlocks(Instruction *terminator)
+{
+    static const std::vector<BasicBlock *> none;
+    Function *function = terminator->getFunction();
+    auto it = controlDependences.find(function);
+    if (it == controlDependences.end())
+    {
+        it = controlDependences.emplace(function, ControlDependences()).first;
+        collectControlDependences(*function, it->second);
+    }
+    auto dependents = it->second.find(terminator->getParent());
+    return dependents == it->second.end() ? none : dependents->second;
+}
+
+// 加载完成后构建一次，调用关系变化后由 reloadModules 清空；懒加载时函数体不全，不构建
+ProgramDependenceGraph *IA::getPDG()
+{
+    if (lazyLoad)
+    {
+        return nullptr;
+    }
+    if (!pdg)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        pdg.reset(new ProgramDependenceGraph(*this));
+        pdg->build();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "Program dependence graph: " << pdg->getNodeCount() << " nodes, " << pdg->getMemoryUsage() / 1024 << " KB, "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms\n";
+    }
+    return pdg.get();
+}
+
+// 模块被替换后编号中会留下空洞，按当前的模块顺序重新连续编号
+void IA::renumberInstructions()
+{
+    instructionIds.clear();
+    instructionRanges.clear();
+    dataFlowUses.clear();
+    controlDependences.clear();
+    instructionIdCount = 0;
+    for (auto &module : commitBCModules)
+    {
+        for (auto &function : *module)
+        {
+            numberInstructions(function);
+        }
+    }
+}
+
+void IA::compareChanges()
+{
+    for (size_t seedIndex = 0; seedIndex < diffResult.size(); seedIndex++)
+    {
+        std::string fileName = diffResult[seedIndex].first;
+        int lineNumbers = diffResult[seedIndex].second;
+        setOriginalFile(fileName);
+        setOriginalLine(lineNumbers);
+        std::string fileKey = getSourceFileKey(fileName);
+        // 懒加载时先物化摘要中含有该行的函数，物化时其指令加入 lineIndex
+        auto lazyFile = lineFunctions.find(fileKey);
+        if (lazyFile != lineFunctions.end())
+        {
+            auto lazyLine = lazyFile->second.find(lineNumbers);
+            if (lazyLine != lazyFile->second.end())
+            {
+                for (auto *function : lazyLine->second)
+                {
+                    materializeFunction(function);
+                }
+            }
+        }
+        auto file = lineIndex.find(fileKey);
+        if (file == lineIndex.end())
+        {
+            continue;
+        }
+        auto line = file->second.find(lineNumbers);
+        if (line == file->second.end())
+        {
+            continue;
+        }
+        for (auto *inst : line->second)
+        {
+            errs() << "Changed Instruction: " << *inst << "\n";
+            changedInstructions.push_back(inst);
+            changedInstructionSeeds.push_back(seedIndex);
+        }
+    }
+}
+
+llvm::Function *IA::getChangedFunction(llvm::Module &module, const std::string fileName, std::string funcName)
+{
+    std::string moduleName = module.getName().str();
+    std::string moduleFileName = moduleName.substr(moduleName.find_last_of('/') + 1);
+    if (moduleFileName == fileName)
+    {
+        for (auto &f : module)
+        {
+            if (f.getName().str() == funcName)
+            {
+                // llvm::errs() << "Found function: " << f.getName() << "\n";
+                return &f;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void IA::getAllGVs()
+{
+    std::cout << "Get All Global Variables" << std::endl;
+    for (auto &module : commitBCModules)
+    {
+        // errs() << "Module: " << module->getSourceFileName() << "\n";
+        for (auto &gv : module->globals())
+        {
+            // errs() << "Global Variable: " << gv.getName() << "\n";
+            // errs() << "In Module: " << gv.getParent()->getName() << "\n";
+            // errs() << "Uses of this gv:" << gv.getNumUses() << "\n";
+            // for (auto &use : gv.uses())
+            // {
+            //     errs() << "Use: " << *use.getUser() << "\n";
+            // }
+            // errs() << "--------------------------------------" << "\n";
+            globalVariables.push_back(&gv);
+        }
+    }
+    // 每个全局变量的使用在写出 tempInfo 时由 collectGlobalUses 生成，与传播时使用的一致
+    std::cout << "Global Variables: " << globalVariables.size() << std::endl;
+}
+
+std::string IA::removeStructVersionNumber(const std::string &inst)
+{
+    std::string result;
+    size_t lastPos = 0;
+    size_t structPos = inst.find("%struct.", lastPos);
+
+    while (structPos != std::string::npos)
+    {
+        result += inst.substr(lastPos, structPos - lastPos);
+        size_t start = structPos + 8;
+        size_t end = start;
+        while (end < inst.length() && (isalnum(inst[end]) || inst[end] == '_'))
+        {
+            end++;
+        }
+
+        size_t versionStart = inst.find('.', end);
+        if (versionStart != std::string::npos)
+        {
+            size_t versionEnd = versionStart + 1;
+            while (versionEnd < inst.length() && isdigit(inst[versionEnd]))
+            {
+                versionEnd++;
+            }
+            if (versionEnd != versionStart + 1)
+            {
+                result += inst.substr(structPos, versionStart - structPos);
+                lastPos = versionEnd;
+            }
+            else
+            {
+                result += inst.substr(structPos, end - structPos);
+                lastPos = end;
+            }
+        }
+        else
+        {
+            result += inst.substr(structPos, end - structPos);
+            lastPos = end;
+        }
+
+        structPos = inst.find("%struct.", lastPos);
+    }
+
+    result += inst.substr(lastPos);
+
+    size_t debugPos = result.find(", !dbg !");
+    if (debugPos != std::string::npos)
+    {
+        result = result.substr(0, debugPos);
+    }
+
+    return result;
+}
+
+void IA::callAnalyze(CallBase *callStatement)
+{
+    if (auto *CI = dyn_cast<CallBase>(callStatement))
+    {
+        if (CI->isInlineAsm())
+        {
+            // asmCalls.push_back(CI);
+            // errs() << "Asm call: " << *CI << "\n";
+            // errs() << "Asm call Function name: " << CI->getParent()->getName() << "\n";
+        }
+        else if (CI->isIndirectCall() == true)
+        {
+            indirectCalls.push_back(CI);
+            // errs() << "Indirect call: " << *CI << "\n";
+            // errs() << "Indirect call Function name: " << CI->getParent()->getName() << "\n";
+        }
+        else if (getCalledFunctionStripped(CI) == nullptr)
+        {
+            indirectCalls.push_back(CI);
+            // errs() << "Indirect call: " << *CI << "\n";
+            // errs() << "Indirect call Function name: " << CI->getParent()->getName() << "\n";
+        }
+        else
+        {
+            directCalls.push_back(CI);
+            // errs() << "Direct call: " << *CI << "\n";
+            // errs() << "Direct call Function name: " << CI->getParent()->getName() << "\n";
+            if (CI->getCalledFunction())
+            {
+                // errs() << "Direct call target: " << CI->getCalledFunction()->getName() << "\n";
+            }
+            else
+            {
+                // errs() << "Direct call target: Indirect call or target not available\n";
+            }
+        }
+    }
+}
+
+void IA::analyzeAllCallInsts()
+{
+    std::cout << "Analyze All Call Insts" << std::endl;
+    for (auto &module : commitBCModules)
+    {
+        for (auto &function : *module)
+        {
+            analyzeCallInsts(function);
+        }
+    }
+}
+
+void IA::analyzeCallInsts(Function &function)
+{
+    // 有摘要时直接按摘要记录的指令序号分类，不必再逐条打印调用指令
+    auto summary = functionSummaries.find(&function);
+    if (summary != functionSummaries.end())
+    {
+        const std::vector<unsigned> &directIndexes = summary->second.directCallIndexes;
+        const std::vector<unsigned> &indirectIndexes = summary->second.indirectCallIndexes;
+        size_t nextDirect = 0;
+        size_t nextIndirect = 0;
+        unsigned index = 0;
+        for (auto &bb : function)
+        {
+            for (auto &inst : bb)
+            {
+                if (nextDirect < directIndexes.size() && directIndexes[nextDirect] == index)
+                {
+                    directCalls.push_back(&inst);
+                    nextDirect++;
+                }
+                else if (nextIndirect < indirectIndexes.size() && indirectIndexes[nextIndirect] == index)
+                {
+                    indirectCalls.push_back(&inst);
+                    nextIndirect++;
+                }
+                index++;
+            }
+        }
+        return;
+    }
+    for (auto &bb : function)
+    {
+        for (auto &inst : bb)
+        {
+            if (auto callInst = dyn_cast<CallBase>(&inst))
+            {
+                // errs() << "CallInst: " << *callInst << "\n";
+
+                std::string instStr;
+                llvm::raw_string_ostream rso(instStr);
+                callInst->print(rso);
+                rso.flush();
+                if (instStr.find("call void @llvm.dbg.declare(") != std::string::npos)
+                {
+                    continue;
+                }
+                callAnalyze(callInst);
+            }
+        }
+    }
+}
+
+// 传入一个 llvm 函数，返回该函数的所有参数类型
+std::vector<Type *> getFuncParameterTypes(Function *function)
+{
+    std::vector<Type *> parameterTypes;
+    if (!function)
+    {
+        return parameterTypes; // 如果传入的函数为空，则返回空列表
+    }
+
+    for (auto &arg : function->args())
+    {
+        parameterTypes.push_back(arg.getType());
+    }
+
+    return parameterTypes;
+}
+
+// 将 IA 类中的所有 indirectCallInfos 转换为 functionCaller
+void IA::parseICallInfos()
+{
+    // 首先遍历所有的 iCallInfos
+    for (auto &info : iCallInfos)
+    {
+        // 获取其 callStatement
+        Instruction *inst = info.getCallInst();
+        // 获取其可能的 possibleCallees
+        std::vector<Function *> possibleCallees = info.getPossibleCallees();
+
+        // 遍历所有的 possibleCallees
+        for (auto &callee : possibleCallees)
+        {
+            // 首先检查 callee 是否为空
+            if (!callee)
+            {
+                continue;
+            }
+            addCaller(callee, inst);
+        }
+    }
+    // 打印 functionCallers
+    // for (auto &caller : functionCallers)
+    // {
+    //     errs() << "Function: " << caller.getFunction()->getName() << "\n";
+    //     errs() << "Callers: \n";
+    //     for (auto &inst : caller.getPossibleCallers())
+    //     {
+    //         errs() << *inst << "\n";
+    //     }
+    //     errs() << "--------------------------------------" << "\n";
+    // }
+}
+
+// 然后处理所有的 直接调用，将其转换为 functionCaller
+void IA::parseDirectCalls()
+{
+    for (auto &inst : directCalls)
+    {
+        // 将 callInst 转换为 CallBase（call 与 invoke）
+        CallBase *callInst = dyn_cast<CallBase>(inst);
+        if (!callInst)
+        {
+            continue;
+        }
+        Function *callee = getCalledFunctionStripped(callInst);
+        addCaller(callee, callInst);
+    }
+    // 懒加载模式下，此后物化的函数在 indexFunction 中增量加入各个表
+    lazyIndexReady = lazyLoad;
+    // 打印 functionCallers
+    // for (auto &caller : functionCallers)
+    // {
+    //     errs() << "Function: " << caller.getFunction()->getName() << "\n";
+    //     errs() << "Callers: \n";
+    //     for (auto &inst : caller.getPossibleCallers())
+    //     {
+    //         errs() << *inst << "\n";
+    //     }
+    //     errs() << "--------------------------------------" << "\n";
+    // }
+}
+
+// 函数的规范 ID：static 函数各自独立，其余函数按名字合并，这样调用方模块中的声明与定义模块中的函数对应同一个 ID
+unsigned IA::assignFunctionId(Function *function)
+{
+    auto it = functionIds.find(function);
+    if (it != functionIds.end())
+    {
+        return it->second;
+    }
+    unsigned id = functionCallers.size();
+    if (!function->hasLocalLinkage())
+    {
+        auto external = externalFunctionIds.emplace(function->getName().str(), id);
+        id = external.first->second;
+    }
+    if (id == functionCallers.size())
+    {
+        functionCallers.push_back(FunctionCaller(function));
+    }
+    else if (!functionCallers[id].getFunction())
+    {
+        functionCallers[id].setFunction(function);
+    }
+    functionIds[function] = id;
+    return id;
+}
+
+// 同一条调用指令的所有候选在一起加入，因此只需和最后加入的调用点比较即可去重
+void IA::addCaller(Function *callee, Instruction *inst)
+{
+    if (isPruned(inst->getFunction()))
+    {
+        return;
+    }
+    FunctionCaller &caller = functionCallers[assignFunctionId(callee)];
+    const std::vector<Instruction *> &callers = caller.getPossibleCallers();
+    if (callers.empty() || callers.back() != inst)
+    {
+        caller.addPossibleCaller(inst);
+    }
+}
+
+unsigned IA::assignGlobalId(GlobalVariable *gv)
+{
+    auto it = globalIds.find(gv);
+    if (it != globalIds.end())
+    {
+        return it->second;
+    }
+    unsigned id = linkedGlobals.size();
+    if (!gv->hasLocalLinkage())
+    {
+        id = externalGlobalIds.emplace(gv->getName().str(), id).first->second;
+    }
+    if (id == linkedGlobals.size())
+    {
+        linkedGlobals.emplace_back();
+    }
+    linkedGlobals[id].push_back(gv);
+    globalIds[gv] = id;
+    return id;
+}
+
+// 函数的地址是否逃逸：被保存、作为参数传递或出现在全局变量的初始值中，只作为被调用者（包括经过 bitcast）不算
+// 懒加载时函数体已丢弃，函数体中的使用由摘要记录
+static bool hasAddressTakenUse(Value *value)
+{
+    for (const Use &use : value->uses())
+    {
+        User *user = use.getUser();
+        if (auto *callInst = dyn_cast<CallBase>(user))
+        {
+            if (&use == &callInst->getCalledOperandUse())
+            {
+                continue;
+            }
+            return true;
+        }
+        if (auto *constantExpr = dyn_cast<ConstantExpr>(user))
+        {
+            if (constantExpr->isCast())
+            {
+                if (hasAddressTakenUse(constantExpr))
+                {
+                    return true;
+                }
+                continue;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// 链接步骤：各模块单独加载，跨模块的调用与 extern 全局变量通过规范 ID 对应到同一个符号
+void IA::linkModuleSymbols(Module &module)
+{
+    for (auto &function : module)
+    {
+        assignFunctionId(&function);
+        if (hasAddressTakenUse(&function))
+        {
+            markAddressTaken(&function);
+        }
+    }
+    for (auto &gv : module.globals())
+    {
+        assignGlobalId(&gv);
+    }
+}
+
+// 卸载模块前移除其符号；按名字分配的 ID 保留，之后重新加载同名符号时沿用
+void IA::unlinkModuleSymbols(Module &module)
+{
+    for (auto &function : module)
+    {
+        if (addressTakenFunctions.erase(&function))
+        {
+            addressTakenCounts[functionIds[&function]]--;
+        }
+        functionIds.erase(&function);
+    }
+    for (auto &gv : module.globals())
+    {
+        auto it = globalIds.find(&gv);
+        if (it == globalIds.end())
+        {
+            continue;
+        }
+        auto &globals = linkedGlobals[it->second];
+        globals.erase(std::remove(globals.begin(), globals.end(), &gv), globals.end());
+        globalIds.erase(it);
+    }
+}
+
+const std::vector<GlobalVariable *> &IA::getLinkedGlobals(GlobalVariable *gv)
+{
+    return linkedGlobals[assignGlobalId(gv)];
+}
+
+// 全局变量（含其他模块中的同一符号）的全部使用指令，g.f、arr[k] 等经常量表达式（GEP、bitcast）的使用也包括在内
+// 入口不可达的函数不会执行，其中的使用不算受影响
+void IA::collectGlobalUses(GlobalVariable *gv, std::vector<Instruction *> &uses)
+{
+    uses.clear();
+    std::vector<User *> users;
+    std::unordered_set<ConstantExpr *> visitedExprs;
+    for (GlobalVariable *linked : getLinkedGlobals(gv))
+    {
+        materializeUsersOf(linked);
+        users.assign(linked->user_begin(), linked->user_end());
+        while (!users.empty())
+        {
+            User *user = users.back();
+            users.pop_back();
+            if (auto *use = dyn_cast<Instruction>(user))
+            {
+                if (!isPruned(use->getFunction()))
+                {
+                    uses.push_back(use);
+                }
+            }
+            else if (auto *expr = dyn_cast<ConstantExpr>(user))
+            {
+                if (visitedExprs.insert(expr).second)
+                {
+                    users.insert(users.end(), expr->user_begin(), expr->user_end());
+                }
+            }
+        }
+    }
+}
+
+void IA::addFunctionInfo(FunctionInformation functionInfo)
+{
+    signatureBuckets[getSignatureHash(functionInfo.getReturnType(), functionInfo.getArgTypes())].push_back(functionInfo.getFunction());
+    functionInfos.push_back(functionInfo);
+}
+
+const std::vector<Function *> &IA::getSignatureBucket(uint64_t signatureHash) const
+{
+    static const std::vector<Function *> emptyBucket;
+    auto it = signatureBuckets.find(signatureHash);
+    return it == signatureBuckets.end() ? emptyBucket : it->second;
+}
+
+// 被取地址的函数按规范 ID 计数：extern 声明在某个模块中被取地址时，其他模块中的定义同样可能被间接调用
+void IA::markAddressTaken(Function *function)
+{
+    unsigned id = assignFunctionId(function);
+    if (addressTakenCounts.size() <= id)
+    {
+        addressTakenCounts.resize(id + 1, 0);
+    }
+    if (addressTakenFunctions.insert(function).second)
+    {
+        addressTakenCounts[id]++;
+    }
+}
+
+bool IA::isAddressTaken(Function *function) const
+{
+    auto it = functionIds.find(function);
+    return it != functionIds.end() && it->second < addressTakenCounts.size() && addressTakenCounts[it->second] > 0;
+}
+
+void IA::clearICallCandidates()
+{
+    for (auto &ici : iCallInfos)
+    {
+        for (auto *callee : ici.getPossibleCallees())
+        {
+            functionCallers[functionIds[callee]].removePossibleCaller(ici.getCallInst());
+        }
+        ici.setPossibleCallees({});
+    }
+}
+
+void IA::matchICallCandidates()
+{
+    for (auto &ici : iCallInfos)
+    {
+        resolveICall(ici, *this);
+        for (auto *callee : ici.getPossibleCallees())
+        {
+            addCaller(callee, ici.getCallInst());
+        }
+        iCallInputs[ici.getCallInst()] = getICallInputsHash(ici, *this);
+    }
+    changedSignatures.clear();
+}
+
+// 卸载模块之前调用：候选中含有该模块函数的调用清空候选，之后由 rematchICallCandidates 重新解析
+void IA::releaseICallCandidates(Module &module)
+{
+    for (auto &ici : iCallInfos)
+    {
+        const std::vector<Function *> &callees = ici.getPossibleCallees();
+        if (std::none_of(callees.begin(), callees.end(), [&module](Function *callee)
+                         { return callee->getParent() == &module; }))
+        {
+            continue;
+        }
+        for (auto *callee : callees)
+        {
+            functionCallers[functionIds[callee]].removePossibleCaller(ici.getCallInst());
+        }
+        ici.setPossibleCallees({});
+        iCallInputs.erase(ici.getCallInst());
+    }
+}
+
+// 模块加入之后、卸载之前调用：记录其中取了地址的函数（含 extern 声明）所在的签名桶
+void IA::noteAddressTakenSignatures(Module &module)
+{
+    for (auto &function : module)
+    {
+        if (isAddressTaken(&function))
+        {
+            changedSignatures.insert(getSignatureHash(function.getReturnType(), getFuncParameterTypes(&function)));
+        }
+    }
+}
+
+// 模块变化后只重新解析结果可能变化的调用：新加入或候选被清空的调用、签名桶中取地址的函数有增减的调用，
+// 以及运行时记录、虚表、字段索引或指针分析给出的目标有变化的调用。其余调用的候选与调用关系保持不变
+void IA::rematchICallCandidates()
+{
+    size_t rematched = 0;
+    for (auto &ici : iCallInfos)
+    {
+        uint64_t inputs = getICallInputsHash(ici, *this);
+        auto previous = iCallInputs.find(ici.getCallInst());
+        if (previous != iCallInputs.end() && previous->second == inputs && !changedSignatures.count(getSignatureHash(ici.getReturnType(), ici.getArgTypes())))
+        {
+            continue;
+        }
+        for (auto *callee : ici.getPossibleCallees())
+        {
+            functionCallers[functionIds[callee]].removePossibleCaller(ici.getCallInst());
+        }
+        ici.setPossibleCallees({});
+        resolveICall(ici, *this);
+        for (auto *callee : ici.getPossibleCallees())
+        {
+            addCaller(callee, ici.getCallInst());
+        }
+        iCallInputs[ici.getCallInst()] = inputs;
+        rematched++;
+    }
+    changedSignatures.clear();
+    std::cout << "Rematched indirect calls: " << rematched << "/" << iCallInfos.size() << std::endl;
+}
+
+// 入口可达的函数集合变化后，按新的集合重新加入直接调用；间接调用随后由 matchICallCandidates 加入
+void IA::rebuildDirectCallers()
+{
+    for (auto &caller : functionCallers)
+    {
+        caller.clearPossibleCallers();
+    }
+    for (auto &inst : directCalls)
+    {
+        addCaller(getCalledFunctionStripped(dyn_cast<CallBase>(inst)), inst);
+    }
+}
+
+const std::vector<Instruction *> &IA::getCallSites(Function *function)
+{
+    static const std::vector<Instruction *> noCallSites;
+    auto it = functionIds.find(function);
+    if (it == functionIds.end())
+    {
+        return noCallSites;
+    }
+    return functionCallers[it->second].getPossibleCallers();
+}
+
+// 清空单次查询的状态，加载的模块与建立好的索引保持不变
+void IA::resetQuery()
+{
+    diffResult.clear();
+    changedInstructions.clear();
+    changedInstructionSeeds.clear();
+    impacts.clear();
+    sourceLineInfos.clear();
+}
+
+// 当检查完所有的 impact 之后，我们需要对所有的 IA 类中的 IMPACT 对象进行分析，获取其原代码行号
+void IA::parseSourceLine()
+{
+    int noLocInsts = 0;
+    std::cout << "Parse Source Line informations" << std::endl;
+    // 创建一个 SourceLineInfo 对象
+    SourceLineInfo sli(originalFile, originalLine);
+
+    // 遍历所有的 impact 对象
+    std::cout << "Impacts size: " << impacts.size() << std::endl;
+    for (auto &impact : impacts)
+    {
+        // 将每个 impact 的受影响的指令添加到 SourceLineInfo 对象中
+        for (auto &inst : impact.getImpactedInsts())
+        {
+            // errs() << "Impacted Instruction: " << *inst << "\n";
+            Instruction *impactedInst = dyn_cast<Instruction>(inst);
+            // 确保 impactedInst 不为空
+            if (!impactedInst)
+            {
+                // errs() << "Error: impactedInst is null\n";
+                continue;
+            }
+            // 获取 impactedInst 的 debug location
+            DILocation *loc = impactedInst->getDebugLoc();
+            // 确保 loc 不为空
+            if (!loc)
+            {
+                noLocInsts++;
+                // errs() << "Error: loc is null\n";
+                continue;
+            }
+            unsigned line = loc->getLine();
+            // errs() << "Impacted Instruction Line: " << line << "\n";
+            std::string fileName = loc->getFilename().str();
+            // errs() << "Impacted Instruction File: " << fileName << "\n";
+            sli.addImpactedInst(fileName, line);
         }
     }
     // 将新创建的 SourceLineInfo 对象添加到 IA 的 sourceLineInfos 中
@@ -501,293 +1803,1474 @@ void IA::parseSourceLine()
     addSourceLineInfo(sli);
 }
 
-// void IA::parseSourceLine()
-// {
-//     std::cout << "Parse Source Line informations" << std::endl;
-//     // 遍历所有的 impact 对象
-//     for (auto &impact : impacts)
-//     {
-//         Instruction *originalInst = impact.getOriginalInst();
-//         if (!originalInst)
-//             continue; // 确保 originalInst 不为空
+// void IA::parseSourceLine()
+// {
+//     std::cout << "Parse Source Line informations" << std::endl;
+//     // 遍历所有的 impact 对象
+//     for (auto &impact : impacts)
+//     {
+//         Instruction *originalInst = impact.getOriginalInst();
+//         if (!originalInst)
+//             continue; // 确保 originalInst 不为空
+
+//         Function *function = originalInst->getFunction();
+//         Module *module = function->getParent();
+//         DILocation *loc = originalInst->getDebugLoc();
+
+//         if (!loc)
+//             continue; // 确保 loc 不为空
+
+//         unsigned line = loc->getLine();
+//         std::string fileName = loc->getFilename().str();
+
+//         bool found = false;
+//         for (auto &sli : sourceLineInfos)
+//         {
+//             if (sli.getOriginalInstFile() == fileName && sli.getOriginalInstLine() == line)
+//             {
+//                 found = true;
+//                 // 为已存在的 SourceLineInfo 添加 impact 的受影响的指令
+//                 for (auto &use : impact.getImpactedInsts())
+//                 {
+//                     Instruction *useInst = dyn_cast<Instruction>(use);
+//                     if (!useInst)
+//                         continue; // 确保 useInst 不为空
+
+//                     DILocation *useLoc = useInst->getDebugLoc();
+//                     if (!useLoc)
+//                         continue; // 确保 useLoc 不为空
+
+//                     unsigned useLine = useLoc->getLine();
+//                     std::string useFileName = useLoc->getFilename().str();
+
+//                     sli.addImpactedInst(useFileName, useLine);
+//                 }
+//                 break; // 找到匹配后不需要继续检查其他 SourceLineInfo 对象
+//             }
+//         }
+
+//         if (!found)
+//         {
+//             // 创建一个新的 SourceLineInfo 对象并添加当前 impact 的所有受影响的指令
+//             SourceLineInfo sli(fileName, line);
+//             for (auto &use : impact.getImpactedInsts())
+//             {
+//                 Instruction *useInst = dyn_cast<Instruction>(use);
+//                 if (!useInst)
+//                     continue; // 确保 useInst 不为空
+
+//                 DILocation *useLoc = useInst->getDebugLoc();
+//                 if (!useLoc)
+//                     continue; // 确保 useLoc 不为空
+
+//                 unsigned useLine = useLoc->getLine();
+//                 std::string useFileName = useLoc->getFilename().str();
+
+//                 sli.addImpactedInst(useFileName, useLine);
+//             }
+//             // 将新创建的 SourceLineInfo 对象添加到 IA 的 sourceLineInfos 中
+//             addSourceLineInfo(sli);
+//         }
+//     }
+// }
+
+// 将所有的 sourceLineInfo 写入到文件中
+void IA::writeSourceLineInfo()
+{
+    // 首先获取当前工作目录
+    std::string currentDir = std::filesystem::current_path();
+    // 在当前工作目录下的 result 文件夹下创建一个 sourceLineInfo.txt 文件
+    // 首先检查 result 文件夹是否存在
+    std::string resultDir = currentDir + "/result";
+    if (!std::filesystem::exists(resultDir))
+    {
+        std::filesystem::create_directory(resultDir);
+    }
+    // 检查并创建 sourceLineInfo.txt 文件
+    if (!std::filesystem::exists(resultDir + "/sourceLineInfo.txt"))
+    {
+        std::ofstream sourceLineInfoFile(resultDir + "/sourceLineInfo.txt");
+    }
+    // 如果当前 sourceLineInfo.txt 文件存在，则清空
+    std::ofstream sourceLineInfoFile(resultDir + "/sourceLineInfo.txt");
+    std::cout << "Write Source Line Info into: " << resultDir + "/sourceLineInfo.txt" << std::endl;
+    // 将所有的 sourceLineInfo 写入到文件中
+    std::cout << "Source Line Infos: " << sourceLineInfos.size() << std::endl;
+    for (auto &sli : sourceLineInfos)
+    {
+        sli.writeToFile(sourceLineInfoFile);
+    }
+}
+
+// 将 indirectCalls, directCalls, globalVariables， GlobalVariableInfo, FunctionInfos,functionCallers，ICallInfos, Impacts 写入到文件中
+void IA::writeAllInfoToFile()
+{
+    // 写入目录为 result/tempInfo 文件夹，每个文件名为对应的名字
+    // 首先获取当前工作目录
+    std::string currentDir = std::filesystem::current_path();
+    // 在当前工作目录下的 result/tempInfo 文件夹下创建一个 indirectCalls.txt 文件
+    // 首先检查 result 文件夹是否存在
+    std::string resultDir = currentDir + "/result";
+    if (!std::filesystem::exists(resultDir))
+    {
+        std::filesystem::create_directory(resultDir);
+    }
+    // 检查并创建 tempInfo 文件夹
+    std::string tempInfoDir = resultDir + "/tempInfo";
+    if (!std::filesystem::exists(tempInfoDir))
+    {
+        std::filesystem::create_directory(tempInfoDir);
+    }
+
+    std::error_code EC;
+    llvm::raw_fd_ostream indirectCallsFile(tempInfoDir + "/indirectCalls.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &inst : indirectCalls)
+    {
+        if (inst)
+        {
+            inst->print(indirectCallsFile);
+            indirectCallsFile << "\n"; // For better readability
+        }
+    }
+    llvm::raw_fd_ostream directCallsFile(tempInfoDir + "/directCalls.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &inst : directCalls)
+    {
+        if (inst)
+        {
+            inst->print(directCallsFile);
+            directCallsFile << "\n"; // For better readability
+        }
+    }
+    llvm::raw_fd_ostream globalVariablesFile(tempInfoDir + "/globalVariables.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &gv : globalVariables)
+    {
+        if (gv)
+        {
+            gv->print(globalVariablesFile);
+            globalVariablesFile << "\n"; // For better readability
+        }
+    }
+    llvm::raw_fd_ostream globalVariableInfosFile(tempInfoDir + "/globalVariableInfos.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    globalVariableInfos.clear();
+    for (auto &gv : globalVariables)
+    {
+        std::vector<Instruction *> uses;
+        collectGlobalUses(gv, uses);
+        globalVariableInfos.push_back(GlobalVariableInfo(gv, uses));
+    }
+    for (auto &gvi : globalVariableInfos)
+    {
+        gvi.writeToFile(globalVariableInfosFile);
+    }
+    llvm::raw_fd_ostream functionInfosFile(tempInfoDir + "/functionInfos.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &fi : functionInfos)
+    {
+        fi.writeToFile(functionInfosFile);
+    }
+    llvm::raw_fd_ostream functionCallersFile(tempInfoDir + "/functionCallers.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &fc : functionCallers)
+    {
+        if (fc.getFunction() && !fc.getPossibleCallers().empty())
+        {
+            fc.writeToFile(functionCallersFile);
+        }
+    }
+    llvm::raw_fd_ostream iCallInfosFile(tempInfoDir + "/iCallInfos.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &ici : iCallInfos)
+    {
+        ici.writeToFile(iCallInfosFile);
+    }
+    llvm::raw_fd_ostream impactsFile(tempInfoDir + "/impacts.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &impact : impacts)
+    {
+        impact.writeToFile(impactsFile);
+    }
+    // 将 funcmodule 对应关系写入到文件中
+    llvm::raw_fd_ostream funcModuleFile(tempInfoDir + "/funcModule.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &fm : functionInfos)
+    {
+        fm.writeFuncModuleToFile(funcModuleFile);
+    }
+}
+
+void IA::write_impacts()
+{
+    // 写入目录为 result/tempInfo 文件夹，每个文件名为对应的名字
+    // 首先获取当前工作目录
+    std::string currentDir = std::filesystem::current_path();
+    // 在当前工作目录下的 result/tempInfo 文件夹下创建一个 indirectCalls.txt 文件
+    // 首先检查 result 文件夹是否存在
+    std::string resultDir = currentDir + "/result";
+    if (!std::filesystem::exists(resultDir))
+    {
+        std::filesystem::create_directory(resultDir);
+    }
+    // 检查并创建 tempInfo 文件夹
+    std::string tempInfoDir = resultDir + "/tempInfo";
+    if (!std::filesystem::exists(tempInfoDir))
+    {
+        std::filesystem::create_directory(tempInfoDir);
+    }
+
+    std::error_code EC;
+    llvm::raw_fd_ostream impactsFile(tempInfoDir + "/impacts.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &impact : impacts)
+    {
+        impact.writeToFile(impactsFile);
+    }
+}
+
+// impact_result.txt 为所有种子结果的并集，seed_impact_result.txt 按种子分别列出
+void IA::writeFinalResult()
+{
+    std::string workingDir = std::filesystem::current_path();
+    std::vector<std::set<std::string>> seedResults(diffResult.size());
+    std::set<std::string> unionResult;
+    int noLocCount = 0;
+    for (auto &impact : impacts)
+    {
+        noLocCount += impact.collectFinalResult(seedResults[impact.getSeedIndex()]);
+    }
+    for (auto &seedResult : seedResults)
+    {
+        unionResult.insert(seedResult.begin(), seedResult.end());
+    }
+
+    std::error_code EC;
+    llvm::raw_fd_ostream file(workingDir + "/result/impact_result.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file: " << EC.message() << "\n";
+        return;
+    }
+    for (auto &result : unionResult)
+    {
+        file << result << "\n";
+    }
+
+    llvm::raw_fd_ostream seedFile(workingDir + "/result/seed_impact_result.txt", EC);
+    if (EC)
+    {
+        llvm::errs() << "Error opening file: " << EC.message() << "\n";
+        return;
+    }
+    for (size_t i = 0; i < diffResult.size(); i++)
+    {
+        seedFile << "Seed: " << diffResult[i].first << ":" << diffResult[i].second << " (" << seedResults[i].size() << ")\n";
+        for (auto &result : seedResults[i])
+        {
+            seedFile << result << "\n";
+        }
+        seedFile << "\n";
+    }
+    std::cout << "Seeds: " << diffResult.size() << ", impacted lines: " << unionResult.size() << "\n";
+    std::cout << "No location count: " << noLocCount << "\n";
+}
+
+// (结构体, 字段) -> 存入其中的函数。有摘要的函数（懒加载或使用缓存时）从摘要中读取，其余的扫描函数体
+void IA::buildFieldIndex()
+{
+    fieldFunctions.clear();
+    escapedFields.clear();
+    FieldStores fieldStores;
+    for (auto &module : commitBCModules)
+    {
+        for (auto &gv : module->globals())
+        {
+            if (gv.hasInitializer())
+            {
+                collectInitializerFields(gv.getInitializer(), "", fieldStores);
+            }
+        }
+        for (auto &function : *module)
+        {
+            if (isPruned(&function))
+            {
+                continue;
+            }
+            auto summary = functionSummaries.find(&function);
+            if (summary != functionSummaries.end())
+            {
+                const FieldStores &summaryStores = summary->second.fieldStores;
+                fieldStores.functions.insert(fieldStores.functions.end(), summaryStores.functions.begin(), summaryStores.functions.end());
+                fieldStores.escaped.insert(fieldStores.escaped.end(), summaryStores.escaped.begin(), summaryStores.escaped.end());
+            }
+            else if (!function.isDeclaration())
+            {
+                collectFieldStores(function, fieldStores);
+            }
+        }
+    }
+    for (auto &stored : fieldStores.functions)
+    {
+        auto &functions = fieldFunctions[stored.first];
+        if (std::find(functions.begin(), functions.end(), stored.second) == functions.end())
+        {
+            functions.push_back(stored.second);
+        }
+    }
+    escapedFields.insert(fieldStores.escaped.begin(), fieldStores.escaped.end());
+    std::cout << "Struct field index: " << fieldFunctions.size() << " fields, " << escapedFields.size() << " escaped" << std::endl;
+}
+
+// 字段可能被写入未知的值时返回 nullptr；空键对应无法归属到具体字段的函数
+const std::vector<Function *> *IA::getFieldFunctions(const std::string &fieldKey) const
+{
+    if (escapedFields.count(fieldKey))
+    {
+        return nullptr;
+    }
+    auto it = fieldFunctions.find(fieldKey);
+    return it == fieldFunctions.end() ? nullptr : &it->second;
+}
+
+// 类名去掉模板参数：IR 中的结构体名不带模板参数，同名模板的各个实例合并为一个类
+static std::string stripTemplateArgs(const std::string &name)
+{
+    std::string result;
+    int depth = 0;
+    for (char c : name)
+    {
+        if (c == '<')
+        {
+            depth++;
+        }
+        else if (c == '>' && depth > 0)
+        {
+            depth--;
+        }
+        else if (depth == 0)
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// typeinfo 名（_ZTS...）对应的类名
+static std::string getTypeInfoClassName(const std::string &typeId)
+{
+    std::string demangled = llvm::demangle(typeId);
+    const std::string prefix = "typeinfo name for ";
+    if (demangled.compare(0, prefix.size(), prefix) != 0)
+    {
+        return "";
+    }
+    return stripTemplateArgs(demangled.substr(prefix.size()));
+}
+
+// 结构体类型对应的类名：%class.ns::A.12 -> ns::A
+static std::string getStructClassName(StructType *structType)
+{
+    if (!structType->hasName())
+    {
+        return "";
+    }
+    StringRef name = stripTypeVersion(structType->getName());
+    if (!name.consume_front("class.") && !name.consume_front("struct."))
+    {
+        return "";
+    }
+    return name.str();
+}
+
+// 没有 !type 元数据时的地址点：虚函数表组中每个数组的 RTTI 之后（-fno-rtti 时为第一个函数）
+static void collectVTableAddressPoints(GlobalVariable &gv, std::vector<VTableAddressPoint> &addressPoints)
+{
+    const DataLayout &dataLayout = gv.getParent()->getDataLayout();
+    Constant *init = gv.getInitializer();
+    std::vector<std::pair<ConstantArray *, uint64_t>> tables;
+    if (auto *group = dyn_cast<ConstantStruct>(init))
+    {
+        const StructLayout *layout = dataLayout.getStructLayout(group->getType());
+        for (unsigned i = 0; i < group->getNumOperands(); i++)
+        {
+            if (auto *table = dyn_cast<ConstantArray>(group->getOperand(i)))
+            {
+                tables.emplace_back(table, layout->getElementOffset(i));
+            }
+        }
+    }
+    else if (auto *table = dyn_cast<ConstantArray>(init))
+    {
+        tables.emplace_back(table, 0);
+    }
+    for (auto &table : tables)
+    {
+        uint64_t entrySize = dataLayout.getTypeAllocSize(table.first->getType()->getElementType());
+        for (unsigned i = 0; i < table.first->getNumOperands(); i++)
+        {
+            Value *entry = table.first->getOperand(i)->stripPointerCasts();
+            if (auto *rtti = dyn_cast<GlobalVariable>(entry))
+            {
+                if (rtti->getName().startswith("_ZTI"))
+                {
+                    addressPoints.emplace_back(&gv, table.second + (i + 1) * entrySize);
+                    break;
+                }
+            }
+            if (isa<Function>(entry))
+            {
+                addressPoints.emplace_back(&gv, table.second + i * entrySize);
+                break;
+            }
+        }
+    }
+}
+
+// 从各模块的虚函数表（_ZTV...）、RTTI（_ZTI...）与 !type 元数据恢复类层次与虚函数表地址点
+// 只读取全局变量，懒加载模式下同样可用
+void IA::buildVTableIndex()
+{
+    typeAddressPoints.clear();
+    classAddressPoints.clear();
+    derivedClasses.clear();
+    rttiClasses.clear();
+    classTypeIds.clear();
+    allAddressPoints.clear();
+    std::unordered_set<std::string> namedTypeIds;
+    for (auto &module : commitBCModules)
+    {
+        for (auto &gv : module->globals())
+        {
+            if (!gv.hasInitializer())
+            {
+                continue;
+            }
+            StringRef name = gv.getName();
+            if (name.startswith("_ZTI"))
+            {
+                std::string typeId = "_ZTS" + name.substr(4).str();
+                rttiClasses.insert(typeId);
+                // __si_class_type_info 与 __vmi_class_type_info 中从第三个成员开始出现基类的 typeinfo
+                if (auto *typeInfo = dyn_cast<ConstantStruct>(gv.getInitializer()))
+                {
+                    for (unsigned i = 2; i < typeInfo->getNumOperands(); i++)
+                    {
+                        auto *base = dyn_cast<GlobalVariable>(typeInfo->getOperand(i)->stripPointerCasts());
+                        if (base && base->getName().startswith("_ZTI"))
+                        {
+                            derivedClasses["_ZTS" + base->getName().substr(4).str()].push_back(typeId);
+                        }
+                    }
+                }
+                continue;
+            }
+            if (!name.startswith("_ZTV"))
+            {
+                continue;
+            }
+            std::string typeId = "_ZTS" + name.substr(4).str();
+            if (namedTypeIds.insert(typeId).second)
+            {
+                classTypeIds[getTypeInfoClassName(typeId)].push_back(typeId);
+            }
+            SmallVector<MDNode *, 4> types;
+            gv.getMetadata(LLVMContext::MD_type, types);
+            for (MDNode *type : types)
+            {
+                auto *offset = mdconst::dyn_extract<ConstantInt>(type->getOperand(0));
+                auto *typeName = dyn_cast<MDString>(type->getOperand(1));
+                if (offset && typeName)
+                {
+                    typeAddressPoints[typeName->getString().str()].emplace_back(&gv, offset->getZExtValue());
+                    allAddressPoints.emplace_back(&gv, offset->getZExtValue());
+                }
+            }
+            if (types.empty())
+            {
+                size_t first = allAddressPoints.size();
+                collectVTableAddressPoints(gv, allAddressPoints);
+                auto &addressPoints = classAddressPoints[typeId];
+                addressPoints.insert(addressPoints.end(), allAddressPoints.begin() + first, allAddressPoints.end());
+            }
+        }
+    }
+    std::cout << "VTable index: " << namedTypeIds.size() << " classes, " << allAddressPoints.size() << " address points" << std::endl;
+}
+
+// 静态类型为 typeId 的对象上的虚函数调用可能使用的地址点
+// 类型的 RTTI 不在程序中时派生类未知，返回所有地址点
+std::vector<VTableAddressPoint> IA::getVTableAddressPoints(const std::string &typeId) const
+{
+    auto typed = typeAddressPoints.find(typeId);
+    if (typed != typeAddressPoints.end())
+    {
+        return typed->second;
+    }
+    if (!rttiClasses.count(typeId))
+    {
+        return allAddressPoints;
+    }
+    std::vector<VTableAddressPoint> addressPoints;
+    std::unordered_set<std::string> visited = {typeId};
+    std::vector<std::string> worklist = {typeId};
+    while (!worklist.empty())
+    {
+        std::string current = worklist.back();
+        worklist.pop_back();
+        auto own = classAddressPoints.find(current);
+        if (own != classAddressPoints.end())
+        {
+            addressPoints.insert(addressPoints.end(), own->second.begin(), own->second.end());
+        }
+        auto derived = derivedClasses.find(current);
+        if (derived == derivedClasses.end())
+        {
+            continue;
+        }
+        for (auto &derivedTypeId : derived->second)
+        {
+            if (visited.insert(derivedTypeId).second)
+            {
+                worklist.push_back(derivedTypeId);
+            }
+        }
+    }
+    return addressPoints;
+}
 
-//         Function *function = originalInst->getFunction();
-//         Module *module = function->getParent();
-//         DILocation *loc = originalInst->getDebugLoc();
+const std::vector<std::string> *IA::getClassTypeIds(StructType *structType) const
+{
+    std::string className = getStructClassName(structType);
+    if (className.empty())
+    {
+        return nullptr;
+    }
+    auto it = classTypeIds.find(className);
+    return it == classTypeIds.end() ? nullptr : &it->second;
+}
 
-//         if (!loc)
-//             continue; // 确保 loc 不为空
+// 模块对应的 .bc 文件名，与 afl-llvm-pass 输出的文件名一致
+static std::string getModuleFileName(const Module &module)
+{
+    return std::filesystem::path(module.getModuleIdentifier()).filename().string();
+}
 
-//         unsigned line = loc->getLine();
-//         std::string fileName = loc->getFilename().str();
+static std::string getFunctionKey(Function *function)
+{
+    return getModuleFileName(*function->getParent()) + ":" + function->getName().str();
+}
 
-//         bool found = false;
-//         for (auto &sli : sourceLineInfos)
-//         {
-//             if (sli.getOriginalInstFile() == fileName && sli.getOriginalInstLine() == line)
-//             {
-//                 found = true;
-//                 // 为已存在的 SourceLineInfo 添加 impact 的受影响的指令
-//                 for (auto &use : impact.getImpactedInsts())
-//                 {
-//                     Instruction *useInst = dyn_cast<Instruction>(use);
-//                     if (!useInst)
-//                         continue; // 确保 useInst 不为空
+// 读取间接调用记录，每行为 "调用点\t目标"；多个进程追加写入同一文件，重复的行在这里合并
+void IA::loadICallProfile()
+{
+    std::ifstream file(iCallProfilePath);
+    if (!file)
+    {
+        errs() << "Error: cannot open icall profile " << iCallProfilePath << "\n";
+        exit(1);
+    }
+    std::set<std::pair<std::string, std::string>> edges;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t tab = line.find('\t');
+        if (line.empty() || line[0] == '#' || tab == std::string::npos)
+        {
+            continue;
+        }
+        edges.emplace(line.substr(0, tab), line.substr(tab + 1));
+    }
+    observedTargets.clear();
+    observedCallers.clear();
+    for (auto &edge : edges)
+    {
+        observedTargets[edge.first].push_back(edge.second);
+        std::string callerKey = edge.first.substr(0, edge.first.rfind(':'));
+        auto &callers = observedCallers[edge.second];
+        if (std::find(callers.begin(), callers.end(), callerKey) == callers.end())
+        {
+            callers.push_back(callerKey);
+        }
+    }
+    std::cout << "Loaded icall profile: " << observedTargets.size() << " call sites, " << edges.size() << " edges" << std::endl;
+}
 
-//                     DILocation *useLoc = useInst->getDebugLoc();
-//                     if (!useLoc)
-//                         continue; // 确保 useLoc 不为空
+// 按 "x.bc:函数" 查找函数，找不到时返回 nullptr；文件名到模块的表在模块变化后重建
+Function *IA::findFunctionByKey(const std::string &key)
+{
+    size_t colon = key.find(".bc:");
+    if (colon == std::string::npos)
+    {
+        return nullptr;
+    }
+    if (modulesByFileName.empty())
+    {
+        for (auto &module : commitBCModules)
+        {
+            modulesByFileName.emplace(getModuleFileName(*module), module.get());
+        }
+    }
+    auto it = modulesByFileName.find(key.substr(0, colon + 3));
+    return it == modulesByFileName.end() ? nullptr : it->second->getFunction(key.substr(colon + 4));
+}
 
-//                     unsigned useLine = useLoc->getLine();
-//                     std::string useFileName = useLoc->getFilename().str();
+// 调用点的序号与插桩时一致：函数内按指令顺序数的第几个间接调用（不含内联汇编）。
+// 第一次查询某个函数时为其中所有间接调用编号
+std::vector<Function *> IA::getObservedTargets(CallBase *callInst)
+{
+    std::vector<Function *> targets;
+    Function *caller = callInst->getFunction();
+    auto ordinals = iCallSiteOrdinals.find(caller);
+    if (ordinals == iCallSiteOrdinals.end())
+    {
+        ordinals = iCallSiteOrdinals.emplace(caller, std::unordered_map<CallBase *, unsigned>()).first;
+        for (auto &inst : instructions(caller))
+        {
+            auto *other = dyn_cast<CallBase>(&inst);
+            if (other && !other->isInlineAsm() && !getCalledFunctionStripped(other))
+            {
+                ordinals->second.emplace(other, ordinals->second.size());
+            }
+        }
+    }
+    auto ordinal = ordinals->second.find(callInst);
+    if (ordinal == ordinals->second.end())
+    {
+        return targets;
+    }
+    auto it = observedTargets.find(getFunctionKey(caller) + ":" + std::to_string(ordinal->second));
+    if (it == observedTargets.end())
+    {
+        return targets;
+    }
+    for (auto &targetKey : it->second)
+    {
+        if (Function *target = findFunctionByKey(targetKey))
+        {
+            targets.push_back(target);
+        }
+    }
+    return targets;
+}
 
-//                     sli.addImpactedInst(useFileName, useLine);
-//                 }
-//                 break; // 找到匹配后不需要继续检查其他 SourceLineInfo 对象
-//             }
-//         }
+// 整个程序的函数指针指向分析，用于解析间接调用；懒加载时没有函数体，只用签名匹配
+void IA::buildPointsTo()
+{
+    if (lazyLoad)
+    {
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    pointsTo = std::make_unique<PointsToAnalysis>(*this);
+    pointsTo->analyze();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    std::cout << "Points-to analysis time: " << elapsed.count() << " s (" << pointsTo->getNodeCount() << " nodes)" << std::endl;
+}
 
-//         if (!found)
-//         {
-//             // 创建一个新的 SourceLineInfo 对象并添加当前 impact 的所有受影响的指令
-//             SourceLineInfo sli(fileName, line);
-//             for (auto &use : impact.getImpactedInsts())
-//             {
-//                 Instruction *useInst = dyn_cast<Instruction>(use);
-//                 if (!useInst)
-//                     continue; // 确保 useInst 不为空
+// 去掉结构体版本号后的函数签名文本，不同 LLVMContext 中的相同签名得到相同的结果
+// 去掉共享 LLVMContext 为同名结构体追加的 .N 后缀
+StringRef stripTypeVersion(StringRef name)
+{
+    size_t dot = name.rfind('.');
+    if (dot != StringRef::npos && dot + 1 < name.size() && name.substr(dot + 1).find_first_not_of("0123456789") == StringRef::npos)
+    {
+        return name.substr(0, dot);
+    }
+    return name;
+}
 
-//                 DILocation *useLoc = useInst->getDebugLoc();
-//                 if (!useLoc)
-//                     continue; // 确保 useLoc 不为空
+static void hashValue(uint64_t &hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x100000001b3ULL;
+}
 
-//                 unsigned useLine = useLoc->getLine();
-//                 std::string useFileName = useLoc->getFilename().str();
+// 与 isSameType 的比较规则一致：命名结构体只看去掉 .N 后缀的名字，
+// 因此哈希与类型所在的 LLVMContext 以及结构体的重命名无关，可以写入缓存
+static void hashType(uint64_t &hash, Type *type)
+{
+    hashValue(hash, type->getTypeID());
+    switch (type->getTypeID())
+    {
+    case Type::IntegerTyID:
+        hashValue(hash, type->getIntegerBitWidth());
+        break;
+    case Type::PointerTyID:
+        hashValue(hash, type->getPointerAddressSpace());
+        hashType(hash, type->getPointerElementType());
+        break;
+    case Type::StructTyID:
+    {
+        StructType *structType = cast<StructType>(type);
+        if (structType->hasName())
+        {
+            hashValue(hash, llvm::xxHash64(stripTypeVersion(structType->getName())));
+            break;
+        }
+        hashValue(hash, structType->getNumElements());
+        hashValue(hash, structType->isPacked());
+        for (Type *element : structType->elements())
+        {
+            hashType(hash, element);
+        }
+        break;
+    }
+    case Type::ArrayTyID:
+        hashValue(hash, type->getArrayNumElements());
+        hashType(hash, type->getArrayElementType());
+        break;
+    case Type::FixedVectorTyID:
+        hashValue(hash, cast<FixedVectorType>(type)->getNumElements());
+        hashType(hash, cast<FixedVectorType>(type)->getElementType());
+        break;
+    case Type::FunctionTyID:
+    {
+        FunctionType *functionType = cast<FunctionType>(type);
+        hashValue(hash, functionType->isVarArg());
+        hashType(hash, functionType->getReturnType());
+        hashValue(hash, functionType->getNumParams());
+        for (Type *param : functionType->params())
+        {
+            hashType(hash, param);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
 
-//                 sli.addImpactedInst(useFileName, useLine);
-//             }
-//             // 将新创建的 SourceLineInfo 对象添加到 IA 的 sourceLineInfos 中
-//             addSourceLineInfo(sli);
-//         }
-//     }
-// }
+// 间接调用与候选函数按签名的结构哈希分桶，匹配时只需查一个桶
+uint64_t getSignatureHash(Type *returnType, ArrayRef<Type *> argTypes)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hashType(hash, returnType);
+    hashValue(hash, argTypes.size());
+    for (Type *argType : argTypes)
+    {
+        hashType(hash, argType);
+    }
+    return hash;
+}
+
+std::string getSignatureKey(Type *returnType, const std::vector<Type *> &argTypes)
+{
+    return llvm::utohexstr(getSignatureHash(returnType, argTypes));
+}
+
+std::string getVirtualCallKey(unsigned numArgs)
+{
+    return "virtual:" + std::to_string(numArgs);
+}
+
+// 被调用的函数，包括经过 bitcast 调用的已知函数；真正的间接调用返回 nullptr
+Function *getCalledFunctionStripped(CallBase *callInst)
+{
+    return dyn_cast<Function>(callInst->getCalledOperand()->stripPointerCasts());
+}
+
+// 收集函数体中与调用、全局变量、源码行相关的信息，函数体丢弃后据此决定物化哪些函数
+// 调用指令的分类规则与 IA::callAnalyze 一致
+FunctionSummary summarizeFunction(Function &function)
+{
+    FunctionSummary summary;
+    std::unordered_set<GlobalVariable *> seenGVs;
+    std::unordered_set<Function *> seenFunctions;
+    unsigned index = 0;
+    for (auto &bb : function)
+    {
+        for (auto &inst : bb)
+        {
+            if (DILocation *loc = inst.getDebugLoc())
+            {
+                summary.lines[loc->getFilename().str()].insert(loc->getLine());
+            }
+            auto *callInst = dyn_cast<CallBase>(&inst);
+            if (callInst && !callInst->isInlineAsm())
+            {
+                Function *callee = getCalledFunctionStripped(callInst);
+                if (callee && callee->getName() == "llvm.dbg.declare")
+                {
+                    // 与 analyzeCallInsts 一样跳过 llvm.dbg.declare
+                }
+                else if (!callee)
+                {
+                    std::vector<Type *> argTypes;
+                    for (auto &arg : callInst->args())
+                    {
+                        argTypes.push_back(arg->getType());
+                    }
+                    summary.indirectCallIndexes.push_back(index);
+                    // 虚函数的重写以派生类为 this，签名与调用不同，按参数个数记录
+                    summary.iCallSignatures.push_back(isVirtualCall(callInst) ? getVirtualCallKey(callInst->arg_size()) : getSignatureKey(callInst->getType(), argTypes));
+                }
+                else
+                {
+                    summary.directCallIndexes.push_back(index);
+                    summary.directCallees.push_back(callee->getName().str());
+                }
+            }
+            std::vector<Value *> operands;
+            for (auto &operand : inst.operands())
+            {
+                // 直接调用的被调用者不算取地址
+                if (callInst && &operand == &callInst->getCalledOperandUse() && getCalledFunctionStripped(callInst))
+                {
+                    continue;
+                }
+                operands.push_back(operand.get());
+            }
+            while (!operands.empty())
+            {
+                Value *operand = operands.back();
+                operands.pop_back();
+                if (auto *gv = dyn_cast<GlobalVariable>(operand))
+                {
+                    if (seenGVs.insert(gv).second)
+                    {
+                        summary.globalVariables.push_back(gv);
+                    }
+                }
+                else if (auto *function = dyn_cast<Function>(operand))
+                {
+                    if (seenFunctions.insert(function).second)
+                    {
+                        summary.addressTakenFunctions.push_back(function);
+                    }
+                }
+                else if (auto *constantExpr = dyn_cast<ConstantExpr>(operand))
+                {
+                    operands.insert(operands.end(), constantExpr->op_begin(), constantExpr->op_end());
+                }
+            }
+            index++;
+        }
+    }
+    collectFieldStores(function, summary.fieldStores);
+    summary.bodyHash = getFunctionBodyHash(function);
+    return summary;
+}
+
+// 丢弃函数体并恢复为可物化状态，personality 等存放在模块级记录中，需要手动保留
+void dropFunctionBody(Function &function)
+{
+    Constant *personality = function.hasPersonalityFn() ? function.getPersonalityFn() : nullptr;
+    Constant *prefix = function.hasPrefixData() ? function.getPrefixData() : nullptr;
+    Constant *prologue = function.hasPrologueData() ? function.getPrologueData() : nullptr;
+    function.dropAllReferences();
+    function.setIsMaterializable(true);
+    if (personality)
+    {
+        function.setPersonalityFn(personality);
+    }
+    if (prefix)
+    {
+        function.setPrefixData(prefix);
+    }
+    if (prologue)
+    {
+        function.setPrologueData(prologue);
+    }
+}
+
+void IA::addFunctionSummary(Function *function, FunctionSummary summary)
+{
+    for (auto &callee : summary.directCallees)
+    {
+        Function *calleeFunction = function->getParent()->getFunction(callee);
+        if (!calleeFunction)
+        {
+            continue;
+        }
+        auto &callers = summaryCallers[assignFunctionId(calleeFunction)];
+        if (callers.empty() || callers.back() != function)
+        {
+            callers.push_back(function);
+        }
+    }
+    for (auto &signature : summary.iCallSignatures)
+    {
+        auto &callers = summaryICallers[signature];
+        if (callers.empty() || callers.back() != function)
+        {
+            callers.push_back(function);
+        }
+    }
+    for (auto *gv : summary.globalVariables)
+    {
+        summaryGVUsers[gv].push_back(function);
+    }
+    for (auto *addressTaken : summary.addressTakenFunctions)
+    {
+        markAddressTaken(addressTaken);
+    }
+    if (lazyLoad)
+    {
+        for (auto &fileLines : summary.lines)
+        {
+            auto &lines = lineFunctions[getSourceFileKey(fileLines.first)];
+            for (unsigned line : fileLines.second)
+            {
+                lines[line].push_back(function);
+            }
+        }
+    }
+    functionSummaries[function] = std::move(summary);
+}
 
-// 将所有的 sourceLineInfo 写入到文件中
-void IA::writeSourceLineInfo()
+void IA::materializeFunction(Function *function)
 {
-    // 首先获取当前工作目录
-    std::string currentDir = std::filesystem::current_path();
-    // 在当前工作目录下的 result 文件夹下创建一个 sourceLineInfo.txt 文件
-    // 首先检查 result 文件夹是否存在
-    std::string resultDir = currentDir + "/result";
-    if (!std::filesystem::exists(resultDir))
+    if (!lazyLoad || !function)
     {
-        std::filesystem::create_directory(resultDir);
+        return;
     }
-    // 检查并创建 sourceLineInfo.txt 文件
-    if (!std::filesystem::exists(resultDir + "/sourceLineInfo.txt"))
+    auto it = materializedIndex.find(function);
+    if (it != materializedIndex.end())
     {
-        std::ofstream sourceLineInfoFile(resultDir + "/sourceLineInfo.txt");
+        materializedFunctions.splice(materializedFunctions.begin(), materializedFunctions, it->second);
+        return;
     }
-    // 如果当前 sourceLineInfo.txt 文件存在，则清空
-    std::ofstream sourceLineInfoFile(resultDir + "/sourceLineInfo.txt");
-    std::cout << "Write Source Line Info into: " << resultDir + "/sourceLineInfo.txt" << std::endl;
-    // 将所有的 sourceLineInfo 写入到文件中
-    std::cout << "Source Line Infos: " << sourceLineInfos.size() << std::endl;
-    for (auto &sli : sourceLineInfos)
+    if (!function->isMaterializable())
     {
-        sli.writeToFile(sourceLineInfoFile);
+        return;
+    }
+    if (Error err = function->materialize())
+    {
+        errs() << "Error: failed to materialize " << function->getName() << ": " << toString(std::move(err)) << "\n";
+        exit(1);
+    }
+    materializedFunctions.push_front(function);
+    materializedIndex[function] = materializedFunctions.begin();
+    indexLines(*function);
+    numberInstructions(*function);
+    if (lazyIndexReady)
+    {
+        indexFunction(function);
     }
 }
 
-// 将 indirectCalls, directCalls, globalVariables， GlobalVariableInfo, FunctionInfos,functionCallers，ICallInfos, Impacts 写入到文件中
-void IA::writeAllInfoToFile()
+// 根据摘要找出所有可能调用 function 的函数：直接调用同一规范 ID 的，记录中调用过它的，以及含有签名匹配的间接调用的
+// 签名只是结构哈希，冲突时会多出一些函数，真正的调用关系仍由 resolveICall 判定
+void IA::getSummaryCallers(Function *function, std::vector<Function *> &callers)
 {
-    // 写入目录为 result/tempInfo 文件夹，每个文件名为对应的名字
-    // 首先获取当前工作目录
-    std::string currentDir = std::filesystem::current_path();
-    // 在当前工作目录下的 result/tempInfo 文件夹下创建一个 indirectCalls.txt 文件
-    // 首先检查 result 文件夹是否存在
-    std::string resultDir = currentDir + "/result";
-    if (!std::filesystem::exists(resultDir))
+    callers.clear();
+    auto id = functionIds.find(function);
+    auto it = id == functionIds.end() ? summaryCallers.end() : summaryCallers.find(id->second);
+    if (it != summaryCallers.end())
     {
-        std::filesystem::create_directory(resultDir);
+        callers.insert(callers.end(), it->second.begin(), it->second.end());
     }
-    // 检查并创建 tempInfo 文件夹
-    std::string tempInfoDir = resultDir + "/tempInfo";
-    if (!std::filesystem::exists(tempInfoDir))
+    if (hasICallProfile())
     {
-        std::filesystem::create_directory(tempInfoDir);
+        auto observed = observedCallers.find(getFunctionKey(function));
+        if (observed != observedCallers.end())
+        {
+            for (auto &callerKey : observed->second)
+            {
+                if (Function *caller = findFunctionByKey(callerKey))
+                {
+                    callers.push_back(caller);
+                }
+            }
+        }
     }
+    for (auto &key : {getSignatureKey(function->getReturnType(), getFuncParameterTypes(function)), getVirtualCallKey(function->arg_size())})
+    {
+        auto iCallers = summaryICallers.find(key);
+        if (iCallers != summaryICallers.end())
+        {
+            callers.insert(callers.end(), iCallers->second.begin(), iCallers->second.end());
+        }
+    }
+    if (hasEntries())
+    {
+        callers.erase(std::remove_if(callers.begin(), callers.end(), [this](Function *caller)
+                                     { return isPruned(caller); }),
+                      callers.end());
+    }
+}
 
-    std::error_code EC;
-    llvm::raw_fd_ostream indirectCallsFile(tempInfoDir + "/indirectCalls.txt", EC);
-    if (EC)
+// 物化所有可能调用 function 的函数
+void IA::materializeCallersOf(Function *function)
+{
+    if (!lazyLoad || !callersMaterialized.insert(function).second)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
         return;
     }
-    for (auto &inst : indirectCalls)
+    std::vector<Function *> callers;
+    getSummaryCallers(function, callers);
+    for (auto *caller : callers)
     {
-        if (inst)
-        {
-            inst->print(indirectCallsFile);
-            indirectCallsFile << "\n"; // For better readability
-        }
+        materializeFunction(caller);
     }
-    llvm::raw_fd_ostream directCallsFile(tempInfoDir + "/directCalls.txt", EC);
-    if (EC)
+}
+
+// 调用 function 的函数，可能重复；懒加载时来自摘要
+void IA::getCallerFunctions(Function *function, std::vector<Function *> &callers)
+{
+    if (lazyLoad)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
+        getSummaryCallers(function, callers);
         return;
     }
-    for (auto &inst : directCalls)
+    callers.clear();
+    for (auto *callSite : getCallSites(function))
     {
-        if (inst)
-        {
-            inst->print(directCallsFile);
-            directCallsFile << "\n"; // For better readability
-        }
+        callers.push_back(callSite->getFunction());
     }
-    llvm::raw_fd_ostream globalVariablesFile(tempInfoDir + "/globalVariables.txt", EC);
-    if (EC)
+}
+
+// 第一次使用时构建，调用关系变化后由 reloadModules 清空
+CallGraphIndex *IA::getCallGraph()
+{
+    if (!callGraph)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        callGraph.reset(new CallGraphIndex(*this));
+        callGraph->build();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "Call graph index: " << callGraph->getSCCCount() << " SCCs, "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms\n";
+    }
+    return callGraph.get();
+}
+
+void IA::materializeUsersOf(GlobalVariable *gv)
+{
+    if (!lazyLoad || !gvUsersMaterialized.insert(gv).second)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
         return;
     }
-    for (auto &gv : globalVariables)
+    auto it = summaryGVUsers.find(gv);
+    if (it != summaryGVUsers.end())
     {
-        if (gv)
+        for (auto *user : it->second)
         {
-            gv->print(globalVariablesFile);
-            globalVariablesFile << "\n"; // For better readability
+            if (!isPruned(user))
+            {
+                materializeFunction(user);
+            }
         }
     }
-    llvm::raw_fd_ostream globalVariableInfosFile(tempInfoDir + "/globalVariableInfos.txt", EC);
-    if (EC)
+}
+
+// 将 directCalls 与 indirectCalls 中从给定位置开始新加入的调用指令加入调用者表
+// resolveICalls 为 false 时只登记间接调用，候选留给之后的 rematchICallCandidates
+void IA::indexCallInsts(size_t firstDirectCall, size_t firstIndirectCall, bool resolveICalls)
+{
+    for (size_t i = firstIndirectCall; i < indirectCalls.size(); i++)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
-        return;
+        IndirectCallInfo ici = getCallStatementInfo(dyn_cast<CallBase>(indirectCalls[i]), *this);
+        if (resolveICalls)
+        {
+            resolveICall(ici, *this);
+            if (watchMode)
+            {
+                iCallInputs[indirectCalls[i]] = getICallInputsHash(ici, *this);
+            }
+        }
+        for (auto *callee : ici.getPossibleCallees())
+        {
+            addCaller(callee, indirectCalls[i]);
+        }
+        addICallInfo(ici);
     }
-    for (auto &gvi : globalVariableInfos)
+    for (size_t i = firstDirectCall; i < directCalls.size(); i++)
     {
-        gvi.writeToFile(globalVariableInfosFile);
+        addCaller(getCalledFunctionStripped(dyn_cast<CallBase>(directCalls[i])), directCalls[i]);
     }
-    llvm::raw_fd_ostream functionInfosFile(tempInfoDir + "/functionInfos.txt", EC);
-    if (EC)
+}
+
+// 将新物化函数中的调用增量加入各个表
+void IA::indexFunction(Function *function)
+{
+    size_t firstDirectCall = directCalls.size();
+    size_t firstIndirectCall = indirectCalls.size();
+    analyzeCallInsts(*function);
+    indexCallInsts(firstDirectCall, firstIndirectCall);
+}
+
+void IA::dematerializeFunction(Function *function)
+{
+    auto inFunction = [function](Instruction *inst)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
-        return;
+        return inst->getFunction() == function;
+    };
+    directCalls.erase(std::remove_if(directCalls.begin(), directCalls.end(), inFunction), directCalls.end());
+    for (auto *inst : indirectCalls)
+    {
+        if (inFunction(inst))
+        {
+            iCallInputs.erase(inst);
+        }
     }
-    for (auto &fi : functionInfos)
+    indirectCalls.erase(std::remove_if(indirectCalls.begin(), indirectCalls.end(), inFunction), indirectCalls.end());
+    iCallInfos.erase(std::remove_if(iCallInfos.begin(), iCallInfos.end(), [&](const IndirectCallInfo &ici)
+                                    { return inFunction(ici.getCallInst()); }),
+                     iCallInfos.end());
+    for (auto &caller : functionCallers)
     {
-        fi.writeToFile(functionInfosFile);
+        caller.removePossibleCallersIn(function);
     }
-    llvm::raw_fd_ostream functionCallersFile(tempInfoDir + "/functionCallers.txt", EC);
-    if (EC)
+    unindexLines(*function);
+    unnumberInstructions(*function);
+    dropFunctionBody(*function);
+}
+
+// 在两次查询之间调用：丢弃最久未使用的函数体，使常驻的函数体数量不超过 lazyCacheLimit
+void IA::trimMaterializedFunctions()
+{
+    if (!lazyLoad || materializedFunctions.size() <= lazyCacheLimit)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
         return;
     }
-    for (auto &fc : functionCallers)
+    std::unordered_set<Function *> pinned;
+    for (auto *inst : changedInstructions)
     {
-        fc.writeToFile(functionCallersFile);
+        pinned.insert(inst->getFunction());
     }
-    llvm::raw_fd_ostream iCallInfosFile(tempInfoDir + "/iCallInfos.txt", EC);
-    if (EC)
+    for (auto &impact : impacts)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
-        return;
+        for (auto *inst : impact.getImpactedInsts())
+        {
+            pinned.insert(inst->getFunction());
+        }
     }
-    for (auto &ici : iCallInfos)
+    bool evicted = false;
+    auto it = materializedFunctions.end();
+    while (materializedFunctions.size() > lazyCacheLimit && it != materializedFunctions.begin())
     {
-        ici.writeToFile(iCallInfosFile);
+        --it;
+        Function *function = *it;
+        if (pinned.count(function))
+        {
+            continue;
+        }
+        dematerializeFunction(function);
+        materializedIndex.erase(function);
+        it = materializedFunctions.erase(it);
+        evicted = true;
     }
-    llvm::raw_fd_ostream impactsFile(tempInfoDir + "/impacts.txt", EC);
-    if (EC)
+    // 被丢弃函数中的调用点已从表中移除，之后需要重新物化
+    if (evicted)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
-        return;
+        callersMaterialized.clear();
+        gvUsersMaterialized.clear();
     }
-    for (auto &impact : impacts)
+}
+
+// 监视模式下重新加载发生变化的 .bc 文件：内容未变的跳过，被删除的移除，
+// 其余的先从各个表中移除旧模块的条目，再把新模块的条目增量加入，不重建整个索引
+void IA::reloadModules(const std::vector<std::string> &paths)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t reloaded = 0;
+    // 指向关系随模块变化，第一次改动模块之前丢弃；间接调用的候选在全部完成后只对可能变化的调用重新匹配。
+    // 使用 --entry 时可达函数集合会变，调用关系整体重建
+    auto prepareChange = [this, &reloaded]()
     {
-        impact.writeToFile(impactsFile);
+        if (reloaded == 0)
+        {
+            if (hasEntries())
+            {
+                clearICallCandidates();
+            }
+            pointsTo.reset();
+            callGraph.reset();
+            pdg.reset();
+        }
+        reloaded++;
+    };
+    // 被跳过的重复模块在保留的那一份卸载后重新检查，不再重复时加载
+    std::vector<std::string> pending(paths);
+    auto unload = [this, &pending](size_t moduleIndex)
+    {
+        std::string removedPath = modulePaths[moduleIndex];
+        noteAddressTakenSignatures(*commitBCModules[moduleIndex]);
+        releaseICallCandidates(*commitBCModules[moduleIndex]);
+        unloadModule(moduleIndex);
+        for (auto it = skippedDuplicates.begin(); it != skippedDuplicates.end();)
+        {
+            if (it->second == removedPath)
+            {
+                pending.push_back(it->first);
+                it = skippedDuplicates.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    };
+    for (size_t next = 0; next < pending.size(); next++)
+    {
+        std::string path = pending[next];
+        skippedDuplicates.erase(path);
+        auto loaded = std::find(modulePaths.begin(), modulePaths.end(), path);
+        size_t moduleIndex = loaded - modulePaths.begin();
+        auto buffer = openBitcodeFile(path, true, ioStats);
+        if (!buffer)
+        {
+            if (loaded != modulePaths.end())
+            {
+                std::cout << "Removed " << path << "\n";
+                prepareChange();
+                unload(moduleIndex);
+            }
+            continue;
+        }
+        std::string hash = getContentHash((*buffer)->getBuffer());
+        if (loaded != modulePaths.end() && moduleHashes[moduleIndex] == hash)
+        {
+            continue;
+        }
+        std::vector<std::pair<Function *, FunctionSummary>> summaries;
+        bool cacheHit = false;
+        std::unique_ptr<Module> newModule = loadModuleFile(path, *mainContext, summaries, hash, cacheHit);
+        if (!newModule)
+        {
+            errs() << "Error: failed to load " << path << ", keeping the previous version\n";
+            continue;
+        }
+        prepareChange();
+        if (loaded != modulePaths.end())
+        {
+            unload(moduleIndex);
+        }
+        std::string fingerprint = getModuleFingerprint(*newModule, summaries);
+        std::string duplicateOf = findDuplicateModule(hash, fingerprint, path);
+        if (!duplicateOf.empty())
+        {
+            std::cout << "Skipping duplicate module " << path << " (same as " << duplicateOf << ")\n";
+            skippedDuplicates[path] = duplicateOf;
+            continue;
+        }
+        std::cout << "Reloaded " << path << "\n";
+        addModule(std::move(newModule), summaries);
+        noteAddressTakenSignatures(*commitBCModules.back());
+        recordModulePath(path, hash, fingerprint);
     }
-    // 将 funcmodule 对应关系写入到文件中
-    llvm::raw_fd_ostream funcModuleFile(tempInfoDir + "/funcModule.txt", EC);
-    if (EC)
+    if (reloaded == 0)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
         return;
     }
-    for (auto &fm : functionInfos)
+    updateProgramHash();
+    if (hasEntries())
     {
-        fm.writeFuncModuleToFile(funcModuleFile);
+        clearICallCandidates();
+        computeEntryReachability();
+        rebuildDirectCallers();
+    }
+    if (!iCallProfileOnly)
+    {
+        buildFieldIndex();
+        buildVTableIndex();
+        buildPointsTo();
+    }
+    if (hasEntries())
+    {
+        matchICallCandidates();
+    }
+    else
+    {
+        rematchICallCandidates();
     }
+    // 新模块可能包含任意函数的调用者或全局变量的使用者
+    callersMaterialized.clear();
+    gvUsersMaterialized.clear();
+    renumberInstructions();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    std::cout << "Reload time: " << elapsed.count() << " s (" << reloaded << " modules)" << std::endl;
 }
 
-void IA::write_impacts()
+// 从所有表中移除属于该模块的函数、调用、全局变量以及以其函数为目标的调用关系，然后释放模块
+void IA::unloadModule(size_t moduleIndex)
 {
-    // 写入目录为 result/tempInfo 文件夹，每个文件名为对应的名字
-    // 首先获取当前工作目录
-    std::string currentDir = std::filesystem::current_path();
-    // 在当前工作目录下的 result/tempInfo 文件夹下创建一个 indirectCalls.txt 文件
-    // 首先检查 result 文件夹是否存在
-    std::string resultDir = currentDir + "/result";
-    if (!std::filesystem::exists(resultDir))
+    Module *oldModule = commitBCModules[moduleIndex].get();
+    auto inModule = [oldModule](Instruction *inst)
     {
-        std::filesystem::create_directory(resultDir);
+        return inst->getModule() == oldModule;
+    };
+    auto functionInModule = [oldModule](Function *function)
+    {
+        return function->getParent() == oldModule;
+    };
+    directCalls.erase(std::remove_if(directCalls.begin(), directCalls.end(), inModule), directCalls.end());
+    for (auto *inst : indirectCalls)
+    {
+        if (inModule(inst))
+        {
+            iCallInputs.erase(inst);
+        }
     }
-    // 检查并创建 tempInfo 文件夹
-    std::string tempInfoDir = resultDir + "/tempInfo";
-    if (!std::filesystem::exists(tempInfoDir))
+    indirectCalls.erase(std::remove_if(indirectCalls.begin(), indirectCalls.end(), inModule), indirectCalls.end());
+    iCallInfos.erase(std::remove_if(iCallInfos.begin(), iCallInfos.end(), [&](const IndirectCallInfo &ici)
+                                    { return inModule(ici.getCallInst()); }),
+                     iCallInfos.end());
+    for (auto &caller : functionCallers)
     {
-        std::filesystem::create_directory(tempInfoDir);
+        caller.removePossibleCallersIn(oldModule);
+    }
+    unlinkModuleSymbols(*oldModule);
+    // 代表函数属于旧模块的 ID 换成其他模块中仍然存在的同 ID 函数
+    for (auto &caller : functionCallers)
+    {
+        if (caller.getFunction() && functionInModule(caller.getFunction()))
+        {
+            caller.setFunction(nullptr);
+        }
+    }
+    for (auto &functionId : functionIds)
+    {
+        if (!functionCallers[functionId.second].getFunction())
+        {
+            functionCallers[functionId.second].setFunction(functionId.first);
+        }
+    }
+    functionInfos.erase(std::remove_if(functionInfos.begin(), functionInfos.end(), [&](FunctionInformation &info)
+                                       { return functionInModule(info.getFunction()); }),
+                        functionInfos.end());
+    for (auto &bucket : signatureBuckets)
+    {
+        bucket.second.erase(std::remove_if(bucket.second.begin(), bucket.second.end(), functionInModule), bucket.second.end());
     }
+    commitBCFunctions.erase(std::remove_if(commitBCFunctions.begin(), commitBCFunctions.end(), functionInModule), commitBCFunctions.end());
+    globalVariables.erase(std::remove_if(globalVariables.begin(), globalVariables.end(), [&](GlobalVariable *gv)
+                                         { return gv->getParent() == oldModule; }),
+                          globalVariables.end());
 
-    std::error_code EC;
-    llvm::raw_fd_ostream impactsFile(tempInfoDir + "/impacts.txt", EC);
-    if (EC)
+    // 行号索引、懒加载的摘要与已物化函数
+    for (auto &function : *oldModule)
     {
-        llvm::errs() << "Error opening file for writing: " << EC.message() << "\n";
-        return;
+        unindexLines(function);
+        unnumberInstructions(function);
+        instructionRanges.erase(&function);
+        auto summary = functionSummaries.find(&function);
+        if (summary != functionSummaries.end())
+        {
+            for (auto &fileLines : summary->second.lines)
+            {
+                auto &lines = lineFunctions[getSourceFileKey(fileLines.first)];
+                for (unsigned line : fileLines.second)
+                {
+                    auto &functions = lines[line];
+                    functions.erase(std::remove(functions.begin(), functions.end(), &function), functions.end());
+                }
+            }
+        }
+        functionSummaries.erase(&function);
+        callersMaterialized.erase(&function);
+        auto materialized = materializedIndex.find(&function);
+        if (materialized != materializedIndex.end())
+        {
+            materializedFunctions.erase(materialized->second);
+            materializedIndex.erase(materialized);
+        }
     }
-    for (auto &impact : impacts)
+    for (auto &callers : summaryCallers)
     {
-        impact.writeToFile(impactsFile);
+        callers.second.erase(std::remove_if(callers.second.begin(), callers.second.end(), functionInModule), callers.second.end());
+    }
+    for (auto &callers : summaryICallers)
+    {
+        callers.second.erase(std::remove_if(callers.second.begin(), callers.second.end(), functionInModule), callers.second.end());
+    }
+    for (auto it = summaryGVUsers.begin(); it != summaryGVUsers.end();)
+    {
+        if (it->first->getParent() == oldModule)
+        {
+            gvUsersMaterialized.erase(it->first);
+            it = summaryGVUsers.erase(it);
+            continue;
+        }
+        it->second.erase(std::remove_if(it->second.begin(), it->second.end(), functionInModule), it->second.end());
+        ++it;
     }
+
+    modulesByFileName.clear();
+    moduleByHash.erase(moduleHashes[moduleIndex]);
+    moduleByFingerprint.erase(moduleFingerprints[moduleIndex]);
+    commitBCModules.erase(commitBCModules.begin() + moduleIndex);
+    modulePaths.erase(modulePaths.begin() + moduleIndex);
+    moduleHashes.erase(moduleHashes.begin() + moduleIndex);
+    moduleFingerprints.erase(moduleFingerprints.begin() + moduleIndex);
 }
 
-llvm::AAResults &IA::getAliasAnalysis()
+// 将新加载模块的函数、全局变量与调用加入各个表
+void IA::addModule(std::unique_ptr<Module> newModule, std::vector<std::pair<Function *, FunctionSummary>> &summaries)
 {
-    if (!aliasAnalysis)
+    Module *module = newModule.get();
+    commitBCModules.push_back(std::move(newModule));
+    modulesByFileName.clear();
+    linkModuleSymbols(*module);
+    for (auto &summary : summaries)
     {
-        // 获取模块的 DataLayout
-        const llvm::DataLayout &DL = module->getDataLayout();
-
-        // 创建 TargetLibraryInfo
-        llvm::Triple ModuleTriple(module->getTargetTriple());
-        auto TLII = std::make_unique<llvm::TargetLibraryInfoImpl>(ModuleTriple);
-        auto TLI = std::make_unique<llvm::TargetLibraryInfo>(*TLII);
-
-        // 初始化 AAResults
-        aliasAnalysis = std::make_unique<llvm::AAResults>(*TLI);
+        addFunctionSummary(summary.first, std::move(summary.second));
+    }
 
-        // 遍历模块中的每个函数
-        for (auto &F : *module)
+    for (auto &function : *module)
+    {
+        if (function.getName().str().find("llvm.dbg.declare") != std::string::npos)
         {
-            // 创建辅助分析对象
-            auto AC = std::make_unique<llvm::AssumptionCache>(F);
-            auto DT = std::make_unique<llvm::DominatorTree>(F);
-            auto LI = std::make_unique<llvm::LoopInfo>(*DT);
-
-            // 使用指针传递 DominatorTree 和 LoopInfo
-            llvm::BasicAAResult BAA(DL, F, *TLI, *AC, DT.get(), LI.get());
-
-            // 将分析结果添加到 AAResults
-            aliasAnalysis->addAAResult(BAA);
+            continue;
         }
+        commitBCFunctions.push_back(&function);
+        indexLines(function);
+        numberInstructions(function);
+        addFunctionInfo(FunctionInformation(&function, getFuncParameterTypes(&function), function.getReturnType()));
+    }
+
+    for (auto &gv : module->globals())
+    {
+        globalVariables.push_back(&gv);
     }
 
-    return *aliasAnalysis;
-}
\ No newline at end of file
+    size_t firstDirectCall = directCalls.size();
+    size_t firstIndirectCall = indirectCalls.size();
+    for (auto &function : *module)
+    {
+        analyzeCallInsts(function);
+    }
+    indexCallInsts(firstDirectCall, firstIndirectCall, false);
+}
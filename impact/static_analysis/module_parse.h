@@ -11,6 +11,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DebugInfo.h"
@@ -29,12 +30,16 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/LLVMContext.h"
 
+#include "bitcode_io.h"
+#include "cdg.h"
+
 #include <vector>
 #include <string>
 #include <memory>
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <climits>
 #include <signal.h>
 #include <execinfo.h>
 #include <unistd.h>
@@ -46,6 +51,11 @@
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <algorithm>
 
 using namespace llvm;
 
@@ -156,10 +166,39 @@ public:
     {
         return this->function;
     }
-    std::vector<Instruction *> getPossibleCallers()
+    void setFunction(Function *function)
+    {
+        this->function = function;
+    }
+    const std::vector<Instruction *> &getPossibleCallers() const
     {
         return this->possibleCallers;
     }
+    bool hasPossibleCaller(Instruction *inst) const
+    {
+        return std::find(this->possibleCallers.begin(), this->possibleCallers.end(), inst) != this->possibleCallers.end();
+    }
+    void clearPossibleCallers()
+    {
+        this->possibleCallers.clear();
+    }
+    void removePossibleCaller(Instruction *inst)
+    {
+        this->possibleCallers.erase(std::remove(this->possibleCallers.begin(), this->possibleCallers.end(), inst), this->possibleCallers.end());
+    }
+
+    void removePossibleCallersIn(Function *caller)
+    {
+        this->possibleCallers.erase(std::remove_if(this->possibleCallers.begin(), this->possibleCallers.end(), [caller](Instruction *inst)
+                                                   { return inst->getFunction() == caller; }),
+                                    this->possibleCallers.end());
+    }
+    void removePossibleCallersIn(Module *module)
+    {
+        this->possibleCallers.erase(std::remove_if(this->possibleCallers.begin(), this->possibleCallers.end(), [module](Instruction *inst)
+                                                   { return inst->getModule() == module; }),
+                                    this->possibleCallers.end());
+    }
 
     void print()
     {
@@ -315,23 +354,23 @@ public:
         this->returnType = returnType;
     }
 
-    Function *getFunction()
+    Function *getFunction() const
     {
         return this->function;
     }
-    Type *getReturnType()
+    Type *getReturnType() const
     {
         return this->returnType;
     }
-    Type *getArgType(int index)
+    Type *getArgType(int index) const
     {
         return this->argTypes[index];
     }
-    std::vector<Type *> getArgTypes()
+    const std::vector<Type *> &getArgTypes() const
     {
         return this->argTypes;
     }
-    int getNumArgs()
+    int getNumArgs() const
     {
         return this->argTypes.size();
     }
@@ -434,33 +473,38 @@ public:
     {
         for (auto *inst : impactedInsts)
         {
-            for (auto *impactedInst : this->impactedInsts)
-            {
-                if (impactedInst == inst)
-                {
-                    return;
-                }
-            }
-            this->impactedInsts.insert(inst);
+            addImpactedInst(inst);
         }
     }
-    void addImpactedInst(Instruction *inst)
+    // 返回是否为新加入的指令；新加入的指令按顺序记录，传播时按此顺序逐条处理
+    bool addImpactedInst(Instruction *inst)
     {
-        for (auto *impactedInst : this->impactedInsts)
+        if (!this->impactedInsts.insert(inst).second)
         {
-            if (impactedInst == inst)
-            {
-                return;
-            }
+            return false;
         }
-        this->impactedInsts.insert(inst);
+        this->addedInsts.push_back(inst);
+        return true;
+    }
+    // 每个函数的数据依赖在一次查询中只需加入一次
+    bool markDataFlowFunction(Function *function)
+    {
+        return this->dataFlowFunctions.insert(function).second;
+    }
+    size_t getAddedCount() const
+    {
+        return this->addedInsts.size();
+    }
+    Instruction *getAddedInst(size_t i) const
+    {
+        return this->addedInsts[i];
     }
 
     Instruction *getOriginalInst()
     {
         return this->originalInst;
     }
-    std::set<Instruction *> getImpactedInsts()
+    const std::set<Instruction *> &getImpactedInsts() const
     {
         return this->impactedInsts;
     }
@@ -491,19 +535,10 @@ public:
         }
     }
 
-    void writeFinalResult()
+    // 将受影响的指令转换为 "file:func:line" 加入 results，返回没有调试信息的指令数
+    int collectFinalResult(std::set<std::string> &results) const
     {
         int noLocCount = 0;
-        std::string workingDir = std::filesystem::current_path();
-        std::string filePath = workingDir + "/result/impact_result.txt";
-        std::remove(filePath.c_str());
-        std::error_code EC;
-        llvm::raw_fd_ostream file(filePath, EC);
-        if (EC)
-        {
-            llvm::errs() << "Error opening file: " << EC.message() << "\n";
-            return;
-        }
         for (auto *inst : this->impactedInsts)
         {
             DILocation *loc = inst->getDebugLoc();
@@ -516,29 +551,99 @@ public:
             std::string funcName = inst->getFunction()->getName().str();
             unsigned line = loc->getLine();
             std::string fileName = loc->getFilename().str();
-            file << fileName << ":" << funcName << ":" << line << "\n";
+            results.insert(fileName + ":" + funcName + ":" + std::to_string(line));
         }
-        std::cout << "No location count: " << noLocCount << "\n";
+        return noLocCount;
+    }
+
+    void setSeedIndex(size_t seedIndex)
+    {
+        this->seedIndex = seedIndex;
+    }
+    size_t getSeedIndex() const
+    {
+        return this->seedIndex;
     }
 
 private:
     Instruction *originalInst;
     std::set<Instruction *> impactedInsts;
+    std::vector<Instruction *> addedInsts; // 与 impactedInsts 内容相同，按加入顺序
+    std::unordered_set<Function *> dataFlowFunctions;
+    size_t seedIndex = 0; // 产生该 impact 的种子在 diffResult 中的下标
+};
+
+// 多层类型分析：存入结构体字段的函数，以及可能被写入未知值的字段；字段记为 "结构体名:字段序号"
+class FieldStores
+{
+public:
+    std::vector<std::pair<std::string, Function *>> functions;
+    std::vector<std::string> escaped;
 };
 
+// 虚函数表中的地址点（虚函数表全局变量, 字节偏移），虚函数调用的槽位从这里开始计算
+typedef std::pair<GlobalVariable *, uint64_t> VTableAddressPoint;
+
+// 懒加载模式下函数体被丢弃后仍需保留的信息，用于决定何时物化哪些函数
+class FunctionSummary
+{
+public:
+    std::map<std::string, std::set<unsigned>> lines;
+    std::vector<unsigned> directCallIndexes; // 调用指令在函数内的序号，与 directCallees 一一对应
+    std::vector<std::string> directCallees;
+    std::vector<unsigned> indirectCallIndexes; // 与 iCallSignatures 一一对应
+    std::vector<std::string> iCallSignatures;  // getSignatureKey 的结果，虚函数调用为 getVirtualCallKey 的结果
+    std::vector<Function *> addressTakenFunctions; // 函数体中取了地址（不只是直接调用）的函数
+    FieldStores fieldStores;
+    std::vector<GlobalVariable *> globalVariables;
+    std::string bodyHash; // getFunctionBodyHash 的结果，函数体被丢弃后用于计算模块指纹
+
+    FunctionSummary() = default;
+};
+
+class PointsToAnalysis;
+class CallGraphIndex;
+class ProgramDependenceGraph;
+
 class IA
 {
 public:
-    IA() = default;
+    IA();
+    ~IA();
 
     bool argsHandle(int argc, char **argv);
-    void parseFileInstNo(std::string fileInstNo);
+    bool parseFileInstNo(std::string fileInstNo);
+    bool parseSeedFile(std::string seedFile);
+    bool parseUnifiedDiff(std::string diffFile);
+    void writeDiffResult();
+    void writeFinalResult();
+    void resetQuery();
     void parseFiles(llvm::LLVMContext &context);
+    std::unique_ptr<llvm::Module> loadModuleFile(const std::string &path, llvm::LLVMContext &context, std::vector<std::pair<Function *, FunctionSummary>> &summaries, std::string &hash, bool &cacheHit);
+    void reloadModules(const std::vector<std::string> &paths);
+    std::string findDuplicateModule(const std::string &hash, const std::string &fingerprint, const std::string &ignoredPath);
+    void recordModulePath(const std::string &path, const std::string &hash, const std::string &fingerprint);
+    void unloadModule(size_t moduleIndex);
+    void addModule(std::unique_ptr<llvm::Module> newModule, std::vector<std::pair<Function *, FunctionSummary>> &summaries);
     void compareChanges();
+    void indexLines(Function &function);
+    void unindexLines(Function &function);
+    void numberInstructions(Function &function);
+    void unnumberInstructions(Function &function);
+    void renumberInstructions();
+    static constexpr unsigned noInstructionId = ~0u;
+    unsigned getInstructionId(Instruction *inst) const
+    {
+        auto it = instructionIds.find(inst);
+        return it == instructionIds.end() ? noInstructionId : it->second;
+    }
+    unsigned getInstructionCount() const { return instructionIdCount; }
+    const std::vector<Instruction *> &getDataFlowUses(Function *function);
+    const std::vector<BasicBlock *> &getControlDependentBlocks(Instruction *terminator);
     llvm::Function *getChangedFunction(llvm::Module &module, std::string fileName, std::string funcName);
-    std::string removeStructVersionNumber(const std::string &str);
+    static std::string removeStructVersionNumber(const std::string &str);
     void analyzeAllCallInsts();
-    void callAnalyze(CallInst *callStatement);
+    void callAnalyze(CallBase *callStatement);
     void getAllGVs();
     void parseICallInfos();
     void parseDirectCalls();
@@ -546,13 +651,51 @@ public:
     void writeSourceLineInfo();
     void writeAllInfoToFile();
     void write_impacts();
-    llvm::AAResults &getAliasAnalysis();
+    void buildPointsTo();
+    void buildFieldIndex();
+    const std::vector<Function *> *getFieldFunctions(const std::string &fieldKey) const;
+    void buildVTableIndex();
+    std::vector<VTableAddressPoint> getVTableAddressPoints(const std::string &typeId) const;
+    const std::vector<std::string> *getClassTypeIds(StructType *structType) const;
+    void loadICallProfile();
+    bool hasICallProfile() const { return !iCallProfilePath.empty(); }
+    bool isICallProfileOnly() const { return iCallProfileOnly; }
+    std::vector<Function *> getObservedTargets(CallBase *callInst);
+    Function *findFunctionByKey(const std::string &key);
+    PointsToAnalysis *getPointsTo() { return pointsTo.get(); }
+    void computeEntryReachability();
+    bool hasEntries() const { return !entryNames.empty(); }
+    bool isPruned(Function *function) const;
+    void materializeFunction(Function *function);
+    void materializeCallersOf(Function *function);
+    void getSummaryCallers(Function *function, std::vector<Function *> &callers);
+    void getCallerFunctions(Function *function, std::vector<Function *> &callers);
+    CallGraphIndex *getCallGraph();
+    ProgramDependenceGraph *getPDG();
+    void materializeUsersOf(GlobalVariable *gv);
+    void trimMaterializedFunctions();
+    void indexCallInsts(size_t firstDirectCall, size_t firstIndirectCall, bool resolveICalls = true);
 
     std::vector<Function *> getCommitBCFunctions() { return commitBCFunctions; }
     std::vector<Instruction *> getChangedInstructions() { return changedInstructions; }
+    size_t getChangedInstructionSeed(size_t i) { return changedInstructionSeeds[i]; }
+    const std::vector<std::pair<std::string, int>> &getSeeds() const { return diffResult; }
     std::vector<Instruction *> getDirectCalls() { return directCalls; }
     std::vector<Instruction *> getIndirectCalls() { return indirectCalls; }
     std::vector<GlobalVariable *> getGlobalVariables() { return globalVariables; }
+    bool isLazyLoad() { return lazyLoad; }
+    int getJobs() const { return jobs; }
+    bool isServeMode() { return serveMode; }
+    bool isWatchMode() { return watchMode; }
+    std::string getCommitBCDir() { return commitBCDir; }
+    std::string getServeSocket() { return serveSocket; }
+    bool isCacheEnabled() { return useCache; }
+    std::string getCacheDir() { return cacheDir; }
+    std::string getProgramHash() { return programHash; }
+    const std::vector<std::unique_ptr<llvm::Module>> &getModules() const
+    {
+        return commitBCModules;
+    }
 
     const std::vector<IndirectCallInfo> &getICallInfos() const
     {
@@ -574,6 +717,14 @@ public:
     {
         return functionCallers;
     }
+    const std::vector<Instruction *> &getCallSites(Function *function);
+    unsigned getFunctionId(Function *function) { return assignFunctionId(function); }
+    unsigned getGlobalId(GlobalVariable *gv) { return assignGlobalId(gv); }
+    size_t getGlobalCount() const { return linkedGlobals.size(); }
+    Function *getFunctionById(unsigned id) { return functionCallers[id].getFunction(); }
+    size_t getFunctionCount() const { return functionCallers.size(); }
+    const std::vector<GlobalVariable *> &getLinkedGlobals(GlobalVariable *gv);
+    void collectGlobalUses(GlobalVariable *gv, std::vector<Instruction *> &uses);
     const std::vector<SourceLineInfo> &getSourceLineInfos() const
     {
         return sourceLineInfos;
@@ -589,19 +740,15 @@ public:
     }
 
     void
-    addFunctionInfo(FunctionInformation functionInfo)
-    {
-        functionInfos.push_back(functionInfo);
-    }
+    addFunctionInfo(FunctionInformation functionInfo);
+    const std::vector<Function *> &getSignatureBucket(uint64_t signatureHash) const;
+    bool isAddressTaken(Function *function) const;
 
+    void setICallInputs(Instruction *callInst, uint64_t inputs) { iCallInputs[callInst] = inputs; }
     void addICallInfo(IndirectCallInfo iCallInfo)
     {
         iCallInfos.push_back(iCallInfo);
     }
-    void addFunctionCaller(FunctionCaller functionCaller)
-    {
-        functionCallers.push_back(functionCaller);
-    }
 
     void addGlobalVariableInfo(GlobalVariableInfo globalVariableInfo)
     {
@@ -617,27 +764,133 @@ public:
     }
 
 private:
-    std::map<std::string, int> diffResult;
+    std::vector<std::pair<std::string, int>> diffResult; // 种子 (file.bc, line)，按输入顺序去重
     std::string workingDir = std::filesystem::current_path();
     std::string commitBCDir = workingDir + "/test/bc";
+    int jobs = 1;
+    std::vector<std::unique_ptr<llvm::LLVMContext>> workerContexts;
     std::vector<std::unique_ptr<llvm::Module>> commitBCModules;
+    // 源文件名（不含目录）-> 行号 -> 该行对应的指令，覆盖所有模块
+    std::unordered_map<std::string, std::unordered_map<unsigned, std::vector<Instruction *>>> lineIndex;
+    // 指令的稠密编号：同一函数的指令按顺序连续编号；懒加载时只有已物化的函数有编号，
+    // 函数体被丢弃后编号区间保留，再次物化时沿用；重新加载模块后整体重新编号
+    std::unordered_map<Instruction *, unsigned> instructionIds;
+    std::unordered_map<Function *, std::pair<unsigned, unsigned>> instructionRanges; // 函数 -> (起始编号, 指令数)
+    unsigned instructionIdCount = 0;
+    std::unordered_map<Function *, std::vector<Instruction *>> dataFlowUses; // 见 collectDataFlowUses，随函数体一起失效
+    std::unordered_map<Function *, ControlDependences> controlDependences; // 见 collectControlDependences，随函数体一起失效
+    std::vector<std::string> modulePaths;  // 与 commitBCModules 一一对应
+    std::vector<std::string> moduleHashes; // 与 commitBCModules 一一对应
+    std::vector<std::string> moduleFingerprints; // 与 commitBCModules 一一对应，见 getModuleFingerprint
+    std::unordered_map<std::string, std::string> moduleByHash;        // 内容哈希 -> 保留的模块路径
+    std::unordered_map<std::string, std::string> moduleByFingerprint; // 指纹 -> 保留的模块路径
+    std::map<std::string, std::string> skippedDuplicates;             // 被跳过的重复模块路径 -> 保留的模块路径
+    llvm::LLVMContext *mainContext = nullptr;
+    BitcodeIOStats ioStats;
     std::vector<Function *> commitBCFunctions;
     std::string originalFile;
     int originalLine;
     std::vector<Instruction *> changedInstructions;
+    std::vector<size_t> changedInstructionSeeds; // 与 changedInstructions 一一对应
     std::vector<Instruction *> directCalls;
     std::vector<Instruction *> indirectCalls;
     std::vector<GlobalVariable *> globalVariables;
     std::vector<IndirectCallInfo> iCallInfos;
     std::vector<FunctionInformation> functionInfos;
-    std::vector<GlobalVariableInfo> globalVariableInfos;
+    std::unordered_map<uint64_t, std::vector<Function *>> signatureBuckets; // getSignatureHash -> 间接调用的候选函数
+    // 监视模式下增量重新解析间接调用，见 rematchICallCandidates
+    std::unordered_map<Instruction *, uint64_t> iCallInputs; // 间接调用 -> 上次解析时的 getICallInputsHash
+    std::unordered_set<uint64_t> changedSignatures;           // 增减了取地址函数的签名桶
+    std::vector<GlobalVariableInfo> globalVariableInfos; // 只在 writeAllInfoToFile 中由 collectGlobalUses 生成
     std::vector<IMPACT> impacts;
+    // 反向调用图：下标为函数的规范 ID，同名的非 static 函数（各模块中的声明与定义）共享一个 ID
     std::vector<FunctionCaller> functionCallers;
+    std::unordered_map<Function *, unsigned> functionIds;
+    std::unordered_map<std::string, unsigned> externalFunctionIds;
+    // 全局符号表：非 static 的全局变量按名字合并，linkedGlobals[id] 为各模块中的 extern 声明与定义
+    std::unordered_map<GlobalVariable *, unsigned> globalIds;
+    std::unordered_map<std::string, unsigned> externalGlobalIds;
+    std::vector<std::vector<GlobalVariable *>> linkedGlobals;
+    // 地址逃逸的函数，只有它们可能是间接调用的目标；addressTakenCounts 以函数的规范 ID 为下标
+    std::unordered_set<Function *> addressTakenFunctions;
+    std::vector<unsigned> addressTakenCounts;
     std::vector<SourceLineInfo> sourceLineInfos;
-    std::unique_ptr<llvm::AAResults> aliasAnalysis;
-    std::unique_ptr<llvm::Module> module;
+    std::unique_ptr<PointsToAnalysis> pointsTo; // 懒加载模式下为空
+    std::unique_ptr<CallGraphIndex> callGraph;
+    std::unique_ptr<ProgramDependenceGraph> pdg; // 懒加载模式下不构建
+    std::unordered_map<std::string, std::vector<Function *>> fieldFunctions;
+    std::unordered_set<std::string> escapedFields;
+    // 虚函数表索引，类型以 typeinfo 名（_ZTS...）表示
+    std::unordered_map<std::string, std::vector<VTableAddressPoint>> typeAddressPoints;  // 来自 !type 元数据，已包含派生类
+    std::unordered_map<std::string, std::vector<VTableAddressPoint>> classAddressPoints; // 没有元数据时，类自己的虚函数表
+    std::unordered_map<std::string, std::vector<std::string>> derivedClasses;            // 由 RTTI 恢复的直接派生类
+    std::unordered_set<std::string> rttiClasses;
+    std::unordered_map<std::string, std::vector<std::string>> classTypeIds; // 去掉模板参数的类名 -> typeinfo 名
+    std::vector<VTableAddressPoint> allAddressPoints;
+
+    bool serveMode = false;
+    bool watchMode = false;
+    std::string serveSocket;
+
+    // 运行测试时由 afl-llvm-pass 插桩记录的间接调用，调用点为 "x.bc:函数:序号"，目标为 "x.bc:函数"
+    std::string iCallProfilePath;
+    bool iCallProfileOnly = false;
+    std::unordered_map<std::string, std::vector<std::string>> observedTargets;
+    std::unordered_map<std::string, std::vector<std::string>> observedCallers; // 目标 -> 调用点所在的函数 "x.bc:函数"
+    std::unordered_map<Function *, std::unordered_map<CallBase *, unsigned>> iCallSiteOrdinals; // 见 getObservedTargets
+    std::unordered_map<std::string, Module *> modulesByFileName;                               // .bc 文件名 -> 模块，见 findFunctionByKey
+
+    // --entry：只保留从入口可达的函数，entryLive 以函数的规范 ID 为下标
+    std::vector<std::string> entryNames;
+    std::vector<char> entryLive;
+
+    // analysis cache
+    bool useCache = false;
+    std::string cacheDir;
+    std::string programHash;
+
+    // lazy loading
+    bool lazyLoad = false;
+    bool lazyIndexReady = false;
+    size_t lazyCacheLimit = 4096;
+    std::unordered_map<Function *, FunctionSummary> functionSummaries;
+    std::unordered_map<unsigned, std::vector<Function *>> summaryCallers; // 键为被调函数的规范 ID
+    std::unordered_map<GlobalVariable *, std::vector<Function *>> summaryGVUsers;
+    std::unordered_map<std::string, std::vector<Function *>> summaryICallers; // 间接调用的签名 -> 含有该调用的函数
+    std::list<Function *> materializedFunctions;
+    std::unordered_map<Function *, std::list<Function *>::iterator> materializedIndex;
+    std::unordered_map<std::string, std::unordered_map<unsigned, std::vector<Function *>>> lineFunctions; // 与 lineIndex 同样的键，来自摘要
+    std::unordered_set<Function *> callersMaterialized;
+    std::unordered_set<GlobalVariable *> gvUsersMaterialized;
+
+    void addFunctionSummary(Function *function, FunctionSummary summary);
+    void analyzeCallInsts(Function &function);
+    void addCaller(Function *callee, Instruction *inst);
+    unsigned assignFunctionId(Function *function);
+    unsigned assignGlobalId(GlobalVariable *gv);
+    void linkModuleSymbols(Module &module);
+    void unlinkModuleSymbols(Module &module);
+    void markAddressTaken(Function *function);
+    void clearICallCandidates();
+    void matchICallCandidates();
+    void releaseICallCandidates(Module &module);
+    void noteAddressTakenSignatures(Module &module);
+    void rematchICallCandidates();
+    void rebuildDirectCallers();
+    void updateProgramHash();
+    void indexFunction(Function *function);
+    void dematerializeFunction(Function *function);
 };
 
 std::vector<Type *> getFuncParameterTypes(Function *function);
+Function *getCalledFunctionStripped(CallBase *callInst);
+StringRef stripTypeVersion(StringRef name);
+uint64_t getSignatureHash(Type *returnType, ArrayRef<Type *> argTypes);
+std::string getSignatureKey(Type *returnType, const std::vector<Type *> &argTypes);
+std::string getVirtualCallKey(unsigned numArgs);
+FunctionSummary summarizeFunction(Function &function);
+std::string getFunctionBodyHash(Function &function);
+std::string getModuleFingerprint(Module &module, const std::vector<std::pair<Function *, FunctionSummary>> &summaries);
+void dropFunctionBody(Function &function);
 
 #endif
\ No newline at end of file
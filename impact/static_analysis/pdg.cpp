@@ -0,0 +1,487 @@
+#include "pdg.h"
+#include "dfg.h"
+#include "sdg.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+ProgramDependenceGraph::ProgramDependenceGraph(IA &ia) : ia(ia)
+{
+}
+
+void ProgramDependenceGraph::build()
+{
+    // 非懒加载时所有函数体都已编号，且编号按函数、基本块连续，没有空洞
+    size_t nodeCount = ia.getInstructionCount();
+    nodes.assign(nodeCount, nullptr);
+    kinds.assign(nodeCount, PLAIN_NODE);
+    nodeBlocks.assign(nodeCount, 0);
+    blockStarts.clear();
+    blockFunctions.clear();
+    functionBlocks.clear();
+
+    std::vector<Function *> functions;
+    for (auto &module : ia.getModules())
+    {
+        for (auto &function : *module)
+        {
+            if (!function.empty())
+            {
+                functions.push_back(&function);
+            }
+        }
+    }
+    std::sort(functions.begin(), functions.end(), [this](Function *a, Function *b)
+              { return ia.getInstructionId(&a->front().front()) < ia.getInstructionId(&b->front().front()); });
+    std::unordered_map<BasicBlock *, unsigned> blockIds;
+    std::vector<ControlDependences> controlDependences(functions.size());
+    for (unsigned f = 0; f < functions.size(); f++)
+    {
+        functionBlocks.push_back(blockStarts.size());
+        collectControlDependences(*functions[f], controlDependences[f]);
+        for (auto &bb : *functions[f])
+        {
+            unsigned block = blockStarts.size();
+            blockIds[&bb] = block;
+            blockStarts.push_back(ia.getInstructionId(&bb.front()));
+            blockFunctions.push_back(f);
+            for (auto &inst : bb)
+            {
+                unsigned node = ia.getInstructionId(&inst);
+                nodes[node] = &inst;
+                nodeBlocks[node] = block;
+            }
+        }
+    }
+    blockStarts.push_back(nodeCount);
+    functionBlocks.push_back(blockStarts.size() - 1);
+
+    // 与 impactAnalyzeGlobal 中的规则相同：写全局变量的 store 优先，其次是 br/switch
+    std::vector<GlobalVariable *> storedGlobals(ia.getGlobalCount(), nullptr);
+    edgeOffsets.assign(nodeCount + 1, 0);
+    edges.clear();
+    for (unsigned node = 0; node < nodeCount; node++)
+    {
+        edgeOffsets[node] = edges.size();
+        Instruction *inst = nodes[node];
+        if (checkGlobalVariableChanges(inst))
+        {
+            kinds[node] = GLOBAL_STORE_NODE;
+            for (GlobalVariable *gv : getStoreGlobalVariables(inst))
+            {
+                unsigned global = ia.getGlobalId(gv);
+                storedGlobals[global] = gv;
+                edges.push_back(global);
+            }
+        }
+        else if (isa<BranchInst>(inst) || isa<SwitchInst>(inst))
+        {
+            kinds[node] = CONTROL_NODE;
+            auto &dependences = controlDependences[blockFunctions[nodeBlocks[node]]];
+            auto dependents = dependences.find(inst->getParent());
+            if (dependents != dependences.end())
+            {
+                for (BasicBlock *dependent : dependents->second)
+                {
+                    edges.push_back(blockIds[dependent]);
+                }
+            }
+        }
+    }
+    edgeOffsets[nodeCount] = edges.size();
+
+    std::vector<Instruction *> uses;
+    globalUseOffsets.assign(storedGlobals.size() + 1, 0);
+    globalUses.clear();
+    for (unsigned global = 0; global < storedGlobals.size(); global++)
+    {
+        globalUseOffsets[global] = globalUses.size();
+        if (!storedGlobals[global])
+        {
+            continue;
+        }
+        ia.collectGlobalUses(storedGlobals[global], uses);
+        for (Instruction *use : uses)
+        {
+            globalUses.push_back(ia.getInstructionId(use));
+        }
+    }
+    globalUseOffsets[storedGlobals.size()] = globalUses.size();
+
+    dataOffsets.assign(functions.size() + 1, 0);
+    dataUses.clear();
+    callSiteOffsets.assign(functions.size() + 1, 0);
+    callSites.clear();
+    for (unsigned f = 0; f < functions.size(); f++)
+    {
+        dataOffsets[f] = dataUses.size();
+        collectDataFlowUses(*functions[f], uses);
+        for (Instruction *use : uses)
+        {
+            dataUses.push_back(ia.getInstructionId(use));
+        }
+        callSiteOffsets[f] = callSites.size();
+        for (Instruction *callSite : ia.getCallSites(functions[f]))
+        {
+            unsigned callNode = ia.getInstructionId(callSite);
+            if (callNode != IA::noInstructionId)
+            {
+                callSites.push_back(callNode);
+            }
+        }
+    }
+    dataOffsets[functions.size()] = dataUses.size();
+    callSiteOffsets[functions.size()] = callSites.size();
+}
+
+size_t ProgramDependenceGraph::getMemoryUsage() const
+{
+    return nodes.capacity() * sizeof(Instruction *) + kinds.capacity() * sizeof(NodeKind) +
+           (nodeBlocks.capacity() + edgeOffsets.capacity() + edges.capacity() + blockStarts.capacity() + blockFunctions.capacity() +
+            functionBlocks.capacity() + dataOffsets.capacity() + dataUses.capacity() + callSiteOffsets.capacity() + callSites.capacity() +
+            globalUseOffsets.capacity() + globalUses.capacity()) *
+               sizeof(unsigned);
+}
+
+// 顺序传播：FIFO 工作表，函数中的指令第一次受影响时加入函数的调用点与数据依赖，
+// 写全局变量的 store 加入其使用（每个全局变量只需一次），br/switch 加入控制依赖于它的基本块
+std::vector<unsigned> ProgramDependenceGraph::propagate(const std::vector<unsigned> &seeds) const
+{
+    std::vector<bool> reached(getNodeCount());
+    std::vector<bool> functionsVisited(getFunctionCount());
+    std::vector<bool> globalsVisited(getGlobalCount());
+    std::vector<unsigned> worklist;
+    auto reach = [&](unsigned node)
+    {
+        if (!reached[node])
+        {
+            reached[node] = true;
+            worklist.push_back(node);
+        }
+    };
+    auto reachAll = [&](std::pair<const unsigned *, const unsigned *> targets)
+    {
+        for (const unsigned *target = targets.first; target != targets.second; target++)
+        {
+            reach(*target);
+        }
+    };
+    auto reachBlock = [&](unsigned block)
+    {
+        auto blockNodes = getBlockNodes(block);
+        for (unsigned node = blockNodes.first; node < blockNodes.second; node++)
+        {
+            reach(node);
+        }
+    };
+    for (unsigned seed : seeds)
+    {
+        reach(seed);
+    }
+
+    for (size_t next = 0; next < worklist.size(); next++)
+    {
+        unsigned node = worklist[next];
+        unsigned block = getBlock(node);
+        unsigned function = getBlockFunction(block);
+        if (!functionsVisited[function])
+        {
+            functionsVisited[function] = true;
+            reachAll(getCallSites(function));
+            reachAll(getDataUses(function));
+        }
+        auto targets = getEdges(node);
+        switch (getKind(node))
+        {
+        case GLOBAL_STORE_NODE:
+            for (const unsigned *target = targets.first; target != targets.second; target++)
+            {
+                if (!globalsVisited[*target])
+                {
+                    globalsVisited[*target] = true;
+                    reachAll(getGlobalUses(*target));
+                }
+            }
+            break;
+        case CONTROL_NODE:
+            for (const unsigned *target = targets.first; target != targets.second; target++)
+            {
+                reachBlock(*target);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return worklist;
+}
+
+// 层与层之间的同步点：全部线程到达后才一起继续
+class LevelBarrier
+{
+public:
+    explicit LevelBarrier(size_t count) : count(count)
+    {
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        size_t current = generation;
+        if (++arrived == count)
+        {
+            arrived = 0;
+            generation++;
+            condition.notify_all();
+            return;
+        }
+        condition.wait(lock, [&]
+                       { return generation != current; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t count;
+    size_t arrived = 0;
+    size_t generation = 0;
+};
+
+// 层同步的并行 BFS：线程在整个查询中只创建一次，每一层按块领取 frontier，新发现的节点以原子操作认领
+// 顺序执行时 FIFO 工作表也是逐层处理的，结果相同，且每一层的节点顺序也与顺序执行时相同：
+//   节点的键为 (发现它的 frontier 位置, 该节点展开时的第几个目标)，取最小值，下一层按键排序即为顺序执行时的加入顺序
+//   函数与全局变量只由本层中位置最小的节点展开，与顺序执行时第一次遇到它的节点相同
+std::vector<unsigned> ProgramDependenceGraph::propagateParallel(const std::vector<unsigned> &seeds, unsigned threads, size_t chunkSize) const
+{
+    const uint64_t unreached = ~0ull;
+    const uint64_t settled = ~0ull - 1; // 已在之前的层中
+    const unsigned noOwner = ~0u;
+    size_t nodeCount = getNodeCount();
+    std::unique_ptr<std::atomic<uint64_t>[]> keys(new std::atomic<uint64_t>[nodeCount]);
+    std::unique_ptr<std::atomic<unsigned>[]> functionOwners(new std::atomic<unsigned>[getFunctionCount()]);
+    std::unique_ptr<std::atomic<unsigned>[]> globalOwners(new std::atomic<unsigned>[getGlobalCount()]);
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        keys[i].store(unreached, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < getFunctionCount(); i++)
+    {
+        functionOwners[i].store(noOwner, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < getGlobalCount(); i++)
+    {
+        globalOwners[i].store(noOwner, std::memory_order_relaxed);
+    }
+    std::vector<char> functionsVisited(getFunctionCount(), 0);
+    std::vector<char> globalsVisited(getGlobalCount(), 0);
+
+    std::vector<unsigned> result;
+    for (unsigned seed : seeds)
+    {
+        if (keys[seed].load(std::memory_order_relaxed) == unreached)
+        {
+            keys[seed].store(settled, std::memory_order_relaxed);
+            result.push_back(seed);
+        }
+    }
+
+    auto lower = [](std::atomic<unsigned> &owner, unsigned value)
+    {
+        unsigned current = owner.load(std::memory_order_relaxed);
+        while (value < current && !owner.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    };
+    // 第一次认领的线程负责把节点放入下一层；之后只把键改小
+    auto discover = [&](unsigned node, uint64_t key, std::vector<unsigned> &found)
+    {
+        uint64_t current = keys[node].load(std::memory_order_relaxed);
+        if (current == settled)
+        {
+            return;
+        }
+        if (current == unreached)
+        {
+            if (keys[node].compare_exchange_strong(current, key, std::memory_order_relaxed))
+            {
+                found.push_back(node);
+                return;
+            }
+        }
+        while (current != settled && key < current && !keys[node].compare_exchange_weak(current, key, std::memory_order_relaxed))
+        {
+        }
+    };
+
+    // 当前层，由 0 号线程在两次同步之间设置
+    size_t workers = std::max(1u, threads);
+    std::vector<std::vector<unsigned>> found(workers);
+    size_t levelStart = 0;
+    const unsigned *frontier = nullptr;
+    size_t frontierSize = 0;
+    size_t chunkCount = 0;
+    std::atomic<size_t> ownerChunks{0};
+    std::atomic<size_t> expandChunks{0};
+    bool done = false;
+    auto startLevel = [&]()
+    {
+        frontier = result.data() + levelStart;
+        frontierSize = result.size() - levelStart;
+        chunkCount = (frontierSize + chunkSize - 1) / chunkSize;
+        ownerChunks = 0;
+        expandChunks = 0;
+        done = frontierSize == 0;
+    };
+    // 各线程从共享的计数器领取下一块，先做完的线程自然会分担剩下的块
+    auto runChunks = [&](std::atomic<size_t> &nextChunk, size_t w, auto &&processChunk)
+    {
+        size_t chunk;
+        while ((chunk = nextChunk++) < chunkCount)
+        {
+            processChunk(w, chunk * chunkSize, std::min(frontierSize, (chunk + 1) * chunkSize));
+        }
+    };
+
+    // 第一步：确定本层中由哪个节点展开各函数与各全局变量
+    auto assignOwners = [&](size_t, size_t begin, size_t end)
+    {
+        for (size_t pos = begin; pos < end; pos++)
+        {
+            unsigned node = frontier[pos];
+            unsigned function = getBlockFunction(getBlock(node));
+            if (!functionsVisited[function])
+            {
+                lower(functionOwners[function], pos);
+            }
+            if (getKind(node) == GLOBAL_STORE_NODE)
+            {
+                auto targets = getEdges(node);
+                for (const unsigned *target = targets.first; target != targets.second; target++)
+                {
+                    if (!globalsVisited[*target])
+                    {
+                        lower(globalOwners[*target], pos);
+                    }
+                }
+            }
+        }
+    };
+
+    // 第二步：展开各节点的边
+    auto expand = [&](size_t w, size_t begin, size_t end)
+    {
+        for (size_t pos = begin; pos < end; pos++)
+        {
+            unsigned node = frontier[pos];
+            uint64_t key = uint64_t(pos) << 32;
+            auto reachAll = [&](std::pair<const unsigned *, const unsigned *> targets)
+            {
+                for (const unsigned *target = targets.first; target != targets.second; target++)
+                {
+                    discover(*target, key++, found[w]);
+                }
+            };
+            unsigned function = getBlockFunction(getBlock(node));
+            if (!functionsVisited[function] && functionOwners[function].load(std::memory_order_relaxed) == pos)
+            {
+                reachAll(getCallSites(function));
+                reachAll(getDataUses(function));
+            }
+            auto targets = getEdges(node);
+            switch (getKind(node))
+            {
+            case GLOBAL_STORE_NODE:
+                for (const unsigned *target = targets.first; target != targets.second; target++)
+                {
+                    if (!globalsVisited[*target] && globalOwners[*target].load(std::memory_order_relaxed) == pos)
+                    {
+                        reachAll(getGlobalUses(*target));
+                    }
+                }
+                break;
+            case CONTROL_NODE:
+                for (const unsigned *target = targets.first; target != targets.second; target++)
+                {
+                    auto blockNodes = getBlockNodes(*target);
+                    for (unsigned next = blockNodes.first; next < blockNodes.second; next++)
+                    {
+                        discover(next, key++, found[w]);
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    };
+
+    // 第三步（0 号线程）：记录已展开的函数与全局变量，下一层按键排序，即顺序执行时的加入顺序
+    auto finishLevel = [&]()
+    {
+        for (size_t pos = 0; pos < frontierSize; pos++)
+        {
+            unsigned node = frontier[pos];
+            functionsVisited[getBlockFunction(getBlock(node))] = 1;
+            if (getKind(node) == GLOBAL_STORE_NODE)
+            {
+                auto targets = getEdges(node);
+                for (const unsigned *target = targets.first; target != targets.second; target++)
+                {
+                    globalsVisited[*target] = 1;
+                }
+            }
+        }
+        std::vector<std::pair<uint64_t, unsigned>> next;
+        for (auto &list : found)
+        {
+            for (unsigned node : list)
+            {
+                next.emplace_back(keys[node].load(std::memory_order_relaxed), node);
+            }
+            list.clear();
+        }
+        std::sort(next.begin(), next.end());
+        levelStart = result.size();
+        for (auto &item : next)
+        {
+            keys[item.second].store(settled, std::memory_order_relaxed);
+            result.push_back(item.second);
+        }
+        startLevel();
+    };
+
+    LevelBarrier barrier(workers);
+    auto worker = [&](size_t w)
+    {
+        while (true)
+        {
+            barrier.wait();
+            if (done)
+            {
+                return;
+            }
+            runChunks(ownerChunks, w, assignOwners);
+            barrier.wait();
+            runChunks(expandChunks, w, expand);
+            barrier.wait();
+            if (w == 0)
+            {
+                finishLevel();
+            }
+        }
+    };
+    startLevel();
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < workers; w++)
+    {
+        pool.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+    return result;
+}
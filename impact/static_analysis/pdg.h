@@ -0,0 +1,103 @@
+#ifndef PDG_H
+#define PDG_H
+
+#include "module_parse.h"
+
+#include <vector>
+
+// 程序依赖图：节点为 IA 中的稠密指令编号（同一函数、同一基本块的指令编号连续），边按类型以 CSR 形式存放
+//   数据边、调用者边：以函数为单位，函数中的任一指令受影响时加入该函数的全部数据依赖与全部调用点
+//   全局变量边：写全局变量的 store -> 全局变量的规范 ID -> 该符号在所有模块中的全部使用
+//   控制边：br/switch -> 控制依赖于它的基本块（见 collectControlDependences），基本块是一段连续的节点编号
+// 只在非懒加载时构建，加载或重新加载模块之后构建一次，之后所有查询都在这张图上传播
+class ProgramDependenceGraph
+{
+public:
+    enum NodeKind : unsigned char
+    {
+        PLAIN_NODE,
+        GLOBAL_STORE_NODE,
+        CONTROL_NODE
+    };
+
+    explicit ProgramDependenceGraph(IA &ia);
+    void build();
+
+    size_t getNodeCount() const
+    {
+        return nodes.size();
+    }
+    size_t getBlockCount() const
+    {
+        return blockStarts.size() - 1;
+    }
+    size_t getGlobalCount() const
+    {
+        return globalUseOffsets.size() - 1;
+    }
+    size_t getFunctionCount() const
+    {
+        return functionBlocks.size() - 1;
+    }
+    Instruction *getInstruction(unsigned node) const
+    {
+        return nodes[node];
+    }
+    NodeKind getKind(unsigned node) const
+    {
+        return kinds[node];
+    }
+    unsigned getBlock(unsigned node) const
+    {
+        return nodeBlocks[node];
+    }
+    unsigned getBlockFunction(unsigned block) const
+    {
+        return blockFunctions[block];
+    }
+    std::pair<unsigned, unsigned> getBlockNodes(unsigned block) const
+    {
+        return {blockStarts[block], blockStarts[block + 1]};
+    }
+    // 全局变量边的目标为全局变量的规范 ID，控制边的目标为基本块
+    std::pair<const unsigned *, const unsigned *> getEdges(unsigned node) const
+    {
+        return {edges.data() + edgeOffsets[node], edges.data() + edgeOffsets[node + 1]};
+    }
+    std::pair<const unsigned *, const unsigned *> getGlobalUses(unsigned global) const
+    {
+        return {globalUses.data() + globalUseOffsets[global], globalUses.data() + globalUseOffsets[global + 1]};
+    }
+    std::pair<const unsigned *, const unsigned *> getDataUses(unsigned function) const
+    {
+        return {dataUses.data() + dataOffsets[function], dataUses.data() + dataOffsets[function + 1]};
+    }
+    std::pair<const unsigned *, const unsigned *> getCallSites(unsigned function) const
+    {
+        return {callSites.data() + callSiteOffsets[function], callSites.data() + callSiteOffsets[function + 1]};
+    }
+    size_t getMemoryUsage() const;
+    // 从 seeds 出发传播，返回按加入顺序排列的全部节点（包括 seeds）
+    std::vector<unsigned> propagate(const std::vector<unsigned> &seeds) const;
+    // 多线程传播，返回的节点及其顺序与 propagate 相同；chunkSize 为线程每次领取的 frontier 节点数
+    std::vector<unsigned> propagateParallel(const std::vector<unsigned> &seeds, unsigned threads, size_t chunkSize = 1024) const;
+
+private:
+    IA &ia;
+    std::vector<Instruction *> nodes;
+    std::vector<NodeKind> kinds;
+    std::vector<unsigned> nodeBlocks;
+    std::vector<unsigned> edgeOffsets;
+    std::vector<unsigned> edges;
+    std::vector<unsigned> blockStarts;    // 基本块 -> 第一个节点，最后一项为节点总数
+    std::vector<unsigned> blockFunctions; // 基本块 -> 函数
+    std::vector<unsigned> functionBlocks; // 函数 -> 第一个基本块
+    std::vector<unsigned> dataOffsets;    // 函数 -> 数据依赖（CSR）
+    std::vector<unsigned> dataUses;
+    std::vector<unsigned> callSiteOffsets; // 函数 -> 调用点（CSR）
+    std::vector<unsigned> callSites;
+    std::vector<unsigned> globalUseOffsets; // 全局变量的规范 ID -> 使用（CSR），只记录被 store 写入的全局变量
+    std::vector<unsigned> globalUses;
+};
+
+#endif
@@ -0,0 +1,533 @@
+#include "points_to.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+PointsToAnalysis::PointsToAnalysis(IA &ia) : ia(ia)
+{
+}
+
+unsigned PointsToAnalysis::makeNode()
+{
+    parents.push_back(parents.size());
+    ranks.push_back(0);
+    pointees.push_back(noNode);
+    unknown.push_back(false);
+    functions.emplace_back();
+    return parents.size() - 1;
+}
+
+unsigned PointsToAnalysis::find(unsigned node)
+{
+    unsigned root = node;
+    while (parents[root] != root)
+    {
+        root = parents[root];
+    }
+    while (parents[node] != root)
+    {
+        unsigned next = parents[node];
+        parents[node] = root;
+        node = next;
+    }
+    return root;
+}
+
+// 合并两个节点；两者都有 pointee 时 pointee 也要合并，用工作表代替递归
+unsigned PointsToAnalysis::join(unsigned a, unsigned b)
+{
+    if (a == noNode || b == noNode)
+    {
+        return a == noNode ? b : a;
+    }
+    std::vector<std::pair<unsigned, unsigned>> worklist = {{a, b}};
+    // 只有一方是 unknown 的合并，合并完成后还要把 unknown 传给新的 pointee
+    std::vector<unsigned> spreadUnknown;
+    while (!worklist.empty())
+    {
+        unsigned x = find(worklist.back().first);
+        unsigned y = find(worklist.back().second);
+        worklist.pop_back();
+        if (x == y)
+        {
+            continue;
+        }
+        if (ranks[x] < ranks[y])
+        {
+            std::swap(x, y);
+        }
+        parents[y] = x;
+        if (ranks[x] == ranks[y])
+        {
+            ranks[x]++;
+        }
+        if (unknown[x] != unknown[y])
+        {
+            unknown[x] = true;
+            spreadUnknown.push_back(x);
+        }
+        if (!functions[y].empty())
+        {
+            std::vector<unsigned> merged;
+            merged.reserve(functions[x].size() + functions[y].size());
+            std::set_union(functions[x].begin(), functions[x].end(), functions[y].begin(), functions[y].end(), std::back_inserter(merged));
+            functions[x].swap(merged);
+            std::vector<unsigned>().swap(functions[y]);
+        }
+        if (pointees[x] == noNode)
+        {
+            pointees[x] = pointees[y];
+        }
+        else if (pointees[y] != noNode)
+        {
+            worklist.emplace_back(pointees[x], pointees[y]);
+        }
+    }
+    for (unsigned node : spreadUnknown)
+    {
+        markUnknown(pointees[find(node)]);
+    }
+    return find(a);
+}
+
+// 标记节点及其 pointee 链为 unknown；unknown 节点的 pointee 总是 unknown，遇到已标记的节点即可停止
+void PointsToAnalysis::markUnknown(unsigned node)
+{
+    while (node != noNode && !unknown[find(node)])
+    {
+        node = find(node);
+        unknown[node] = true;
+        node = pointees[node];
+    }
+}
+
+unsigned PointsToAnalysis::pointee(unsigned node)
+{
+    if (node == noNode)
+    {
+        return noNode;
+    }
+    node = find(node);
+    if (pointees[node] == noNode)
+    {
+        unsigned target = makeNode();
+        pointees[node] = target;
+        unknown[target] = unknown[node];
+    }
+    return pointees[node];
+}
+
+bool PointsToAnalysis::mayHoldPointer(Type *type)
+{
+    if (type->isPointerTy())
+    {
+        return true;
+    }
+    if (!type->isAggregateType() && !type->isVectorTy())
+    {
+        return false;
+    }
+    auto it = pointerTypes.find(type);
+    if (it != pointerTypes.end())
+    {
+        return it->second;
+    }
+    bool holdsPointer = false;
+    if (auto *vectorType = dyn_cast<VectorType>(type))
+    {
+        holdsPointer = mayHoldPointer(vectorType->getElementType());
+    }
+    else
+    {
+        for (Type *element : type->subtypes())
+        {
+            if (mayHoldPointer(element))
+            {
+                holdsPointer = true;
+                break;
+            }
+        }
+    }
+    pointerTypes[type] = holdsPointer;
+    return holdsPointer;
+}
+
+unsigned PointsToAnalysis::getParamNode(unsigned functionId, unsigned argNo)
+{
+    auto inserted = paramNodes.emplace((uint64_t)functionId << 32 | argNo, noNode);
+    if (inserted.second)
+    {
+        inserted.first->second = makeNode();
+    }
+    return inserted.first->second;
+}
+
+unsigned PointsToAnalysis::getReturnNode(unsigned functionId)
+{
+    auto inserted = returnNodes.emplace(functionId, noNode);
+    if (inserted.second)
+    {
+        inserted.first->second = makeNode();
+    }
+    return inserted.first->second;
+}
+
+// 只查找已有的节点，不为查询的值新建节点
+unsigned PointsToAnalysis::lookupNode(Value *value)
+{
+    value = value->stripPointerCasts();
+    if (auto *function = dyn_cast<Function>(value))
+    {
+        auto it = functionNodes.find(ia.getFunctionId(function));
+        return it == functionNodes.end() ? noNode : it->second;
+    }
+    if (auto *argument = dyn_cast<Argument>(value))
+    {
+        auto it = paramNodes.find((uint64_t)ia.getFunctionId(argument->getParent()) << 32 | argument->getArgNo());
+        return it == paramNodes.end() ? noNode : it->second;
+    }
+    auto it = valueNodes.find(value);
+    return it == valueNodes.end() ? noNode : it->second;
+}
+
+// 值所在的节点：函数、参数与全局变量使用按规范 ID 共享的节点，其余的值各自建立节点
+// 不可能含有指针的常量（整数、空指针、undef 等）没有节点
+unsigned PointsToAnalysis::getNode(Value *value)
+{
+    if (auto *function = dyn_cast<Function>(value))
+    {
+        unsigned functionId = ia.getFunctionId(function);
+        auto inserted = functionNodes.emplace(functionId, noNode);
+        if (inserted.second)
+        {
+            inserted.first->second = makeNode();
+            functions[inserted.first->second].push_back(functionId);
+        }
+        return inserted.first->second;
+    }
+    if (auto *gv = dyn_cast<GlobalVariable>(value))
+    {
+        auto inserted = globalNodes.emplace(ia.getGlobalId(gv), noNode);
+        if (inserted.second)
+        {
+            inserted.first->second = makeNode();
+        }
+        return inserted.first->second;
+    }
+    if (auto *alias = dyn_cast<GlobalAlias>(value))
+    {
+        return alias->getAliasee() ? getNode(alias->getAliasee()) : noNode;
+    }
+    if (auto *argument = dyn_cast<Argument>(value))
+    {
+        return getParamNode(ia.getFunctionId(argument->getParent()), argument->getArgNo());
+    }
+    if (isa<ConstantData>(value) || isa<BlockAddress>(value))
+    {
+        return noNode;
+    }
+    auto it = valueNodes.find(value);
+    if (it != valueNodes.end())
+    {
+        return it->second;
+    }
+    unsigned node = noNode;
+    if (auto *constantExpr = dyn_cast<ConstantExpr>(value))
+    {
+        // 常量表达式中的类型转换与地址计算不改变指向的对象
+        if (constantExpr->isCast() || constantExpr->getOpcode() == Instruction::GetElementPtr)
+        {
+            node = getNode(constantExpr->getOperand(0));
+        }
+        else
+        {
+            for (Value *operand : constantExpr->operands())
+            {
+                node = join(node, getNode(operand));
+            }
+        }
+    }
+    else if (auto *aggregate = dyn_cast<ConstantAggregate>(value))
+    {
+        for (Value *operand : aggregate->operands())
+        {
+            node = join(node, getNode(operand));
+        }
+    }
+    else if (isa<Constant>(value))
+    {
+        return noNode;
+    }
+    if (node == noNode)
+    {
+        node = makeNode();
+    }
+    valueNodes[value] = node;
+    return node;
+}
+
+void PointsToAnalysis::linkCall(CallBase *callInst, unsigned functionId, Function *callee)
+{
+    unsigned numParams = callee->arg_size();
+    for (unsigned i = 0; i < callInst->arg_size() && i < numParams; i++)
+    {
+        Value *arg = callInst->getArgOperand(i);
+        if (mayHoldPointer(arg->getType()) || mayHoldPointer(callee->getArg(i)->getType()))
+        {
+            join(getParamNode(functionId, i), getNode(arg));
+        }
+    }
+    if (mayHoldPointer(callInst->getType()))
+    {
+        join(getNode(callInst), getReturnNode(functionId));
+        if (unmodeledFunctions.count(functionId))
+        {
+            markUnknown(getNode(callInst));
+        }
+        else if (libraryFunctions.count(functionId))
+        {
+            // realloc、memchr、strchr 等返回参数所指的内存，按调用点与指针参数合并
+            for (Value *arg : callInst->args())
+            {
+                if (mayHoldPointer(arg->getType()))
+                {
+                    join(getNode(callInst), getNode(arg));
+                }
+            }
+        }
+    }
+}
+
+void PointsToAnalysis::analyzeInstruction(Instruction &inst)
+{
+    switch (inst.getOpcode())
+    {
+    case Instruction::Load:
+        if (mayHoldPointer(inst.getType()))
+        {
+            join(getNode(&inst), pointee(getNode(cast<LoadInst>(inst).getPointerOperand())));
+        }
+        break;
+    case Instruction::Store:
+    {
+        auto &store = cast<StoreInst>(inst);
+        if (mayHoldPointer(store.getValueOperand()->getType()))
+        {
+            join(pointee(getNode(store.getPointerOperand())), getNode(store.getValueOperand()));
+        }
+        break;
+    }
+    case Instruction::AtomicCmpXchg:
+    {
+        auto &cmpXchg = cast<AtomicCmpXchgInst>(inst);
+        if (mayHoldPointer(cmpXchg.getNewValOperand()->getType()))
+        {
+            unsigned contents = pointee(getNode(cmpXchg.getPointerOperand()));
+            join(contents, getNode(cmpXchg.getNewValOperand()));
+            join(getNode(&inst), contents);
+        }
+        break;
+    }
+    case Instruction::AtomicRMW:
+    {
+        auto &rmw = cast<AtomicRMWInst>(inst);
+        if (mayHoldPointer(rmw.getValOperand()->getType()))
+        {
+            unsigned contents = pointee(getNode(rmw.getPointerOperand()));
+            join(contents, getNode(rmw.getValOperand()));
+            join(getNode(&inst), contents);
+        }
+        break;
+    }
+    case Instruction::PtrToInt:
+        // 经过整数的指针运算只跟踪 ptrtoint / inttoptr 直接相连的情况
+        join(getNode(&inst), getNode(inst.getOperand(0)));
+        break;
+    case Instruction::IntToPtr:
+    {
+        // 常量地址不会指向程序中的函数；其余没有节点的整数来历不明
+        unsigned node = lookupNode(inst.getOperand(0));
+        join(getNode(&inst), node);
+        if (node == noNode && !isa<ConstantInt>(inst.getOperand(0)))
+        {
+            markUnknown(getNode(&inst));
+        }
+        break;
+    }
+    case Instruction::VAArg:
+        if (mayHoldPointer(inst.getType()))
+        {
+            markUnknown(getNode(&inst));
+        }
+        break;
+    case Instruction::GetElementPtr:
+    case Instruction::BitCast:
+    case Instruction::AddrSpaceCast:
+    case Instruction::PHI:
+    case Instruction::Select:
+    case Instruction::ExtractValue:
+    case Instruction::InsertValue:
+    case Instruction::ExtractElement:
+    case Instruction::InsertElement:
+    case Instruction::ShuffleVector:
+        if (mayHoldPointer(inst.getType()))
+        {
+            unsigned node = getNode(&inst);
+            for (Value *operand : inst.operands())
+            {
+                if (mayHoldPointer(operand->getType()))
+                {
+                    join(node, getNode(operand));
+                }
+            }
+        }
+        break;
+    case Instruction::Ret:
+    {
+        Value *returnValue = cast<ReturnInst>(inst).getReturnValue();
+        if (returnValue && mayHoldPointer(returnValue->getType()))
+        {
+            join(getReturnNode(ia.getFunctionId(inst.getFunction())), getNode(returnValue));
+        }
+        break;
+    }
+    case Instruction::Call:
+    case Instruction::Invoke:
+    {
+        auto *callInst = cast<CallBase>(&inst);
+        if (callInst->isInlineAsm())
+        {
+            break;
+        }
+        if (auto *memTransfer = dyn_cast<MemTransferInst>(callInst))
+        {
+            join(pointee(getNode(memTransfer->getRawDest())), pointee(getNode(memTransfer->getRawSource())));
+            break;
+        }
+        if (Function *callee = getCalledFunctionStripped(callInst))
+        {
+            if (!callee->isIntrinsic())
+            {
+                linkCall(callInst, ia.getFunctionId(callee), callee);
+            }
+            else if (callee->getIntrinsicID() == Intrinsic::vastart)
+            {
+                // 可变参数由调用方传入，va_list 中保存的区域及从中读出的值都是 unknown
+                markUnknown(pointee(getNode(callInst->getArgOperand(0))));
+            }
+            else if (callee->getIntrinsicID() == Intrinsic::vacopy)
+            {
+                join(pointee(getNode(callInst->getArgOperand(0))), pointee(getNode(callInst->getArgOperand(1))));
+            }
+            break;
+        }
+        indirectCalls.push_back({callInst, getNode(callInst->getCalledOperand())});
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// 程序中没有定义的函数的返回值无法分析。TargetLibraryInfo 认识的库函数（malloc、strchr 等）
+// 只返回新分配的内存或参数中的指针，不算作未建模的来源，返回值在 linkCall 中与指针参数合并
+void PointsToAnalysis::collectUnmodeledFunctions()
+{
+    std::unordered_set<unsigned> definedFunctions;
+    for (auto &module : ia.getModules())
+    {
+        for (auto &function : *module)
+        {
+            if (!function.isDeclaration())
+            {
+                definedFunctions.insert(ia.getFunctionId(&function));
+            }
+        }
+    }
+    for (auto &module : ia.getModules())
+    {
+        TargetLibraryInfoImpl libraryInfoImpl(Triple(module->getTargetTriple()));
+        TargetLibraryInfo libraryInfo(libraryInfoImpl);
+        for (auto &function : *module)
+        {
+            if (!function.isDeclaration() || function.isIntrinsic())
+            {
+                continue;
+            }
+            unsigned functionId = ia.getFunctionId(&function);
+            if (definedFunctions.count(functionId))
+            {
+                continue;
+            }
+            LibFunc libFunc;
+            if (libraryInfo.getLibFunc(function, libFunc))
+            {
+                libraryFunctions.insert(functionId);
+            }
+            else
+            {
+                unmodeledFunctions.insert(functionId);
+            }
+        }
+    }
+}
+
+void PointsToAnalysis::analyze()
+{
+    collectUnmodeledFunctions();
+    for (auto &module : ia.getModules())
+    {
+        for (auto &gv : module->globals())
+        {
+            if (gv.hasInitializer() && mayHoldPointer(gv.getValueType()))
+            {
+                join(pointee(getNode(&gv)), getNode(gv.getInitializer()));
+            }
+        }
+        for (auto &function : *module)
+        {
+            // 入口不可达的函数不会执行，其中的赋值不参与分析
+            if (ia.isPruned(&function))
+            {
+                continue;
+            }
+            for (auto &inst : instructions(function))
+            {
+                analyzeInstruction(inst);
+            }
+        }
+    }
+    // 间接调用的目标随合并不断增加，新出现的目标连接参数与返回值后可能再合并出新的目标，直到不动点
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < indirectCalls.size(); i++)
+        {
+            std::vector<unsigned> targets = functions[find(indirectCalls[i].callee)];
+            for (unsigned functionId : targets)
+            {
+                Function *callee = ia.getFunctionById(functionId);
+                if (callee && linkedCalls.insert((uint64_t)i << 32 | functionId).second)
+                {
+                    linkCall(indirectCalls[i].callInst, functionId, callee);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+std::vector<unsigned> PointsToAnalysis::getFunctionTargets(Value *value)
+{
+    unsigned node = lookupNode(value);
+    if (node == noNode)
+    {
+        return {};
+    }
+    return functions[find(node)];
+}
+
+bool PointsToAnalysis::isUnknown(Value *value)
+{
+    unsigned node = lookupNode(value);
+    return node != noNode && unknown[find(node)];
+}
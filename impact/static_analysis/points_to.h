@@ -0,0 +1,73 @@
+#ifndef POINTS_TO_H
+#define POINTS_TO_H
+
+#include "module_parse.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 基于合一的（Steensgaard 风格）函数指针指向分析，用并查集实现，整个程序的指令只扫描一遍
+// 每个节点表示一类抽象对象：节点记录其中的函数，pointee 为这些对象中保存的值所在的节点
+// 字段不敏感：结构体、数组与其中的元素属于同一个节点
+// 函数、参数、返回值与全局变量按 IA 的规范 ID 建立节点，跨模块的 extern 声明与定义对应同一个节点
+// 未建模的来源（程序外定义的函数的返回值、可变参数、来历不明的整数转换成的指针）所在的节点标记为 unknown，
+// 合并时传递，通过 unknown 节点读出的值同样是 unknown
+// 需要函数体，懒加载模式下不使用
+class PointsToAnalysis
+{
+public:
+    explicit PointsToAnalysis(IA &ia);
+    void analyze();
+    // 值可能指向的函数（规范 ID），无法解析时为空
+    std::vector<unsigned> getFunctionTargets(Value *value);
+    // 值是否可能来自未建模的来源，此时 getFunctionTargets 的结果不完整
+    bool isUnknown(Value *value);
+    size_t getNodeCount() const
+    {
+        return parents.size();
+    }
+
+private:
+    static constexpr unsigned noNode = ~0u;
+
+    IA &ia;
+    std::vector<unsigned> parents;
+    std::vector<unsigned char> ranks;
+    std::vector<unsigned> pointees;
+    std::vector<bool> unknown; // 只在代表节点上有效
+    std::vector<std::vector<unsigned>> functions; // 有序，只在代表节点上有效
+
+    std::unordered_map<Value *, unsigned> valueNodes;
+    std::unordered_map<unsigned, unsigned> functionNodes;
+    std::unordered_map<unsigned, unsigned> globalNodes;
+    std::unordered_map<uint64_t, unsigned> paramNodes; // (函数 ID << 32) | 参数序号
+    std::unordered_map<unsigned, unsigned> returnNodes;
+    std::unordered_map<Type *, bool> pointerTypes;
+    std::unordered_set<unsigned> unmodeledFunctions; // 程序中没有定义、也不是已知库函数的函数 ID
+    std::unordered_set<unsigned> libraryFunctions;   // 程序中没有定义的已知库函数的函数 ID
+
+    struct PendingCall
+    {
+        CallBase *callInst;
+        unsigned callee;
+    };
+    std::vector<PendingCall> indirectCalls;
+    std::unordered_set<uint64_t> linkedCalls; // (间接调用序号 << 32) | 函数 ID
+
+    unsigned makeNode();
+    unsigned find(unsigned node);
+    unsigned join(unsigned a, unsigned b);
+    unsigned pointee(unsigned node);
+    void markUnknown(unsigned node);
+    unsigned getNode(Value *value);
+    unsigned lookupNode(Value *value);
+    unsigned getParamNode(unsigned functionId, unsigned argNo);
+    unsigned getReturnNode(unsigned functionId);
+    bool mayHoldPointer(Type *type);
+    void collectUnmodeledFunctions();
+    void analyzeInstruction(Instruction &inst);
+    void linkCall(CallBase *callInst, unsigned functionId, Function *callee);
+};
+
+#endif
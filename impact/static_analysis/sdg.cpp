@@ -1,69 +1,126 @@
 #include "sdg.h"
 #include "cfg.h"
+#include "pdg.h"
 
-bool checkGlobalVariableChanges(Instruction *inst)
-{
+#include "llvm/Analysis/ValueTracking.h"
 
+// store 涉及的全局变量：被写入的全局变量（指针操作数的基址），以及被保存的全局变量地址（值操作数）
+std::vector<GlobalVariable *> getStoreGlobalVariables(Instruction *inst)
+{
+    std::vector<GlobalVariable *> globals;
     if (auto storeInst = dyn_cast<StoreInst>(inst))
     {
-        Value *storeOperand = storeInst->getValueOperand();
-        if (GlobalVariable *GV = dyn_cast<GlobalVariable>(storeOperand))
+        if (GlobalVariable *GV = dyn_cast<GlobalVariable>(getUnderlyingObject(storeInst->getPointerOperand())))
         {
-            //     errs() << "Store instruction: " << *storeInst << "\n";
-            //     errs() << "In function: " << storeInst->getFunction()->getName() << "\n";
-            //     errs() << "Changes global variable: " << GV->getName() << "\n\n";
-            return true;
+            globals.push_back(GV);
+        }
+        if (GlobalVariable *GV = dyn_cast<GlobalVariable>(storeInst->getValueOperand()))
+        {
+            if (globals.empty() || globals.front() != GV)
+            {
+                globals.push_back(GV);
+            }
         }
     }
-    return false;
+    return globals;
+}
+
+bool checkGlobalVariableChanges(Instruction *inst)
+{
+    //     errs() << "Store instruction: " << *inst << "\n";
+    //     errs() << "In function: " << inst->getFunction()->getName() << "\n";
+    return !getStoreGlobalVariables(inst).empty();
+}
+
+// 与具体查询无关的索引，只需在加载完成后建立一次
+void buildIndexes(IA &ia)
+{
+    ia.getAllGVs();
+    ia.analyzeAllCallInsts();
+    getAllFuncInfo(ia);
+    analyzeAllICalls(ia);
+    ia.parseICallInfos();
+    ia.parseDirectCalls();
+    ia.getPDG();
 }
 
 void checkChanges(IA &ia)
 {
     std::cout << "Checking changes\n";
     std::vector<Instruction *> changedInstructions = ia.getChangedInstructions();
-    for (Instruction *inst : changedInstructions)
+    for (size_t i = 0; i < changedInstructions.size(); i++)
     {
+        Instruction *inst = changedInstructions[i];
         IMPACT impact = IMPACT(inst);
+        impact.setSeedIndex(ia.getChangedInstructionSeed(i));
         // errs() << "Analyzing impact for inst: " << *inst << "\n";
-        constructDFG(inst, impact);
+        constructDFG(inst, ia, impact);
         impactAnalyzeGlobal(impact, ia);
         ia.addImpact(impact);
+        ia.trimMaterializedFunctions();
         // impact.print();
     }
 }
 
-void impactAnalyzeGlobal(IMPACT &impact, IA &ia)
+// 在程序依赖图上传播，规则与下面逐条指令处理的方式相同，见 ProgramDependenceGraph::propagate
+// 指定了 --jobs 时改用多线程的 propagateParallel，结果与顺序相同
+static void impactAnalyzePDG(IMPACT &impact, const ProgramDependenceGraph &pdg, IA &ia)
 {
-    std::set<Instruction *> impactedInstructions = impact.getImpactedInsts();
-    std::vector<BasicBlock *> visitedBlocks;
-    std::vector<Instruction *> visitedSwitchInsts;
-    std::vector<Instruction *> visitedInstructions; // 用于记录已经访问过的指令
-    std::vector<Function *> visitedFunctions;
+    std::vector<unsigned> seeds;
+    for (size_t i = 0; i < impact.getAddedCount(); i++)
+    {
+        seeds.push_back(ia.getInstructionId(impact.getAddedInst(i)));
+    }
+    std::vector<unsigned> reached = ia.getJobs() > 1 ? pdg.propagateParallel(seeds, ia.getJobs()) : pdg.propagate(seeds);
+    for (unsigned node : reached)
+    {
+        impact.addImpactedInst(pdg.getInstruction(node));
+    }
+}
 
-    int i = 0;
-    while (i < impactedInstructions.size())
+// 工作表传播：impact 中新加入的指令即工作表，按加入的顺序逐条处理；
+// 已处理的指令以 IA 中的稠密编号记在位图中，懒加载时物化新函数会使编号增加
+// 非懒加载时改为在程序依赖图上传播
+void impactAnalyzeGlobal(IMPACT &impact, IA &ia)
+{
+    if (ProgramDependenceGraph *pdg = ia.getPDG())
     {
-        Instruction *inst = *std::next(impactedInstructions.begin(), i);
+        impactAnalyzePDG(impact, *pdg, ia);
+        return;
+    }
+    std::vector<bool> processed(ia.getInstructionCount());
+    // 每个函数只加入一次它的调用点
+    std::unordered_set<Function *> visitedFunctions;
 
-        if (std::find(visitedInstructions.begin(), visitedInstructions.end(), inst) != visitedInstructions.end())
+    // 按加入顺序处理，处理过程中新加入的指令都会排在末尾被处理到，与指令地址的先后无关
+    for (size_t next = 0; next < impact.getAddedCount(); next++)
+    {
+        Instruction *inst = impact.getAddedInst(next);
+        unsigned id = ia.getInstructionId(inst);
+        if (id != IA::noInstructionId)
         {
-            // errs() << "Instruction already visited\n";
-            i++;
-            continue;
+            if (id >= processed.size())
+            {
+                processed.resize(ia.getInstructionCount());
+            }
+            if (processed[id])
+            {
+                continue;
+            }
+            processed[id] = true;
         }
 
         Function *func = inst->getFunction();
 
-        std::vector<Instruction *> callTargets = getFunctionCallSites(func, ia);
-        for (auto callTarget : callTargets)
+        if (visitedFunctions.insert(func).second)
         {
-            impact.addImpactedInst(callTarget);
+            for (auto callTarget : getFunctionCallSites(func, ia))
+            {
+                impact.addImpactedInst(callTarget);
+            }
         }
 
-        visitedFunctions.push_back(func);
-
-        constructDFG(inst, impact);
+        constructDFG(inst, ia, impact);
 
         // if (auto returnInst = dyn_cast<ReturnInst>(inst))
         // {
@@ -73,102 +130,49 @@ void impactAnalyzeGlobal(IMPACT &impact, IA &ia)
         {
             analyzeGlobalInst(inst, ia, impact);
         }
-        else if (auto brInst = dyn_cast<BranchInst>(inst))
-        {
-            analyzeBrInst(inst, ia, impact);
-        }
-        else if (auto switchInst = dyn_cast<SwitchInst>(inst))
+        else if (isa<BranchInst>(inst) || isa<SwitchInst>(inst))
         {
-            BasicBlock *parentBlock = inst->getParent();
-            visitedBlocks.push_back(parentBlock);
-            analyzeSwitchInst(inst, ia, impact, visitedBlocks, visitedSwitchInsts);
+            analyzeControlInst(inst, ia, impact);
         }
-
-        visitedInstructions.push_back(inst);
-
-        impactedInstructions = impact.getImpactedInsts();
-        i++;
     }
 }
 
-void constructDFG(Instruction *inst, IMPACT &impact)
+void constructDFG(Instruction *inst, IA &ia, IMPACT &impact)
 {
-    std::vector<DFGNode::Ptr> dfgNodes = analyzeDataFlow(inst);
-    // for (DFGNode::Ptr dfgNode : dfgNodes)
-    // {
-    //     errs() << "DFGNode: " << *dfgNode->getInstruction() << "\n";
-    //     errs() << "In function: " << dfgNode->getInstruction()->getFunction()->getName() << "\n";
-    //     for (DFGNode::Ptr use : dfgNode->getUses())
-    //     {
-    //         errs() << "Uses: " << *use->getInstruction() << "\n";
-    //     }
-    // }
-    std::vector<DFGNode::Ptr> visited;
-    for (DFGNode::Ptr dfgNode : dfgNodes)
+    Function *function = inst->getFunction();
+    if (!impact.markDataFlowFunction(function))
     {
-        findAllUses(impact, dfgNode, visited);
+        return;
     }
-}
-
-void analyzeGlobalInst(Instruction *inst, IA &ia, IMPACT &impact)
-{
-    if (auto storeInst = dyn_cast<StoreInst>(inst))
+    for (Instruction *use : ia.getDataFlowUses(function))
     {
-        Value *storeOperand = storeInst->getValueOperand();
-        if (GlobalVariable *GV = dyn_cast<GlobalVariable>(storeOperand))
-        {
-            // errs() << "Store instruction: " << *storeInst << "\n";
-            // errs() << "In function: " << storeInst->getFunction()->getName() << "\n";
-            // errs() << "Changes global variable: " << GV->getName() << "\n\n";
-            // std::vector<Instruction *> uses = findAllUses(GV);
-            // impact.addImpactedInstsWithVector(uses);
-            for (User *U : GV->users())
-            {
-                if (Instruction *use = dyn_cast<Instruction>(U))
-                {
-                    impact.addImpactedInst(use);
-                }
-            }
-        }
+        impact.addImpactedInst(use);
     }
 }
 
-void analyzeBrInst(Instruction *inst, IA &ia, IMPACT &impact)
+void analyzeGlobalInst(Instruction *inst, IA &ia, IMPACT &impact)
 {
-    // errs() << "Analyzing br instruction: " << *inst << "\n";
-    // 如果该指令是 br 指令
-    if (auto brInst = dyn_cast<BranchInst>(inst))
+    std::vector<Instruction *> uses;
+    for (GlobalVariable *GV : getStoreGlobalVariables(inst))
     {
-        for (unsigned i = 0; i < brInst->getNumSuccessors(); i++)
+        // errs() << "Changes global variable: " << GV->getName() << "\n\n";
+        // 其他模块中的 extern 声明是不同的 GlobalVariable，经全局符号表找到同一符号的全部实例
+        ia.collectGlobalUses(GV, uses);
+        for (Instruction *use : uses)
         {
-            // errs() << "Successor: " << *brInst->getSuccessor(i) << "\n";
-            BasicBlock *successor = brInst->getSuccessor(i);
-            for (Instruction &inst : *successor)
-            {
-                // errs() << "Successor instruction: " << inst << "\n";
-                // 将该基本快的所有指令添加到 impact 的 uses 中
-                impact.addImpactedInst(&inst);
-            }
+            impact.addImpactedInst(use);
         }
     }
 }
 
-void analyzeSwitchInst(Instruction *inst, IA &ia, IMPACT &impact, std::vector<BasicBlock *> &visitedBlocks, std::vector<Instruction *> &visitedSwitchInsts)
+// br/switch：控制依赖于该分支的基本块中的全部指令，见 collectControlDependences
+void analyzeControlInst(Instruction *inst, IA &ia, IMPACT &impact)
 {
-    if (auto switchInst = dyn_cast<SwitchInst>(inst))
+    for (BasicBlock *dependent : ia.getControlDependentBlocks(inst))
     {
-        visitedSwitchInsts.push_back(inst);
-        for (unsigned i = 0; i < switchInst->getNumSuccessors(); i++)
+        for (Instruction &inst : *dependent)
         {
-            BasicBlock *successor = switchInst->getSuccessor(i);
-            if (std::find(visitedBlocks.begin(), visitedBlocks.end(), successor) != visitedBlocks.end())
-            {
-                continue;
-            }
-            for (Instruction &inst : *successor)
-            {
-                impact.addImpactedInst(&inst);
-            }
+            impact.addImpactedInst(&inst);
         }
     }
-}
\ No newline at end of file
+}
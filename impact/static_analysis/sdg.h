@@ -4,13 +4,14 @@
 #include "module_parse.h"
 #include "dfg.h"
 
+std::vector<GlobalVariable *> getStoreGlobalVariables(Instruction *inst);
 bool checkGlobalVariableChanges(Instruction *inst);
+void buildIndexes(IA &ia);
 void checkChanges(IA &ia);
 void impactAnalyzeGlobal(IMPACT &impact, IA &ia);
-void constructDFG(Instruction *inst, IMPACT &impact);
+void constructDFG(Instruction *inst, IA &ia, IMPACT &impact);
 void analyzeGlobalInst(Instruction *inst, IA &ia, IMPACT &impact);
 void analyzeReturnInst(Instruction *inst, IA &ia, IMPACT &impact);
-void analyzeBrInst(Instruction *inst, IA &ia, IMPACT &impact);
-void analyzeSwitchInst(Instruction *inst, IA &ia, IMPACT &impact, std::vector<BasicBlock *> &visitedBlocks, std::vector<Instruction *> &visitedSwitchInsts);
+void analyzeControlInst(Instruction *inst, IA &ia, IMPACT &impact);
 
 #endif
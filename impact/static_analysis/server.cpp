@@ -0,0 +1,396 @@
+#include "server.h"
+#include "sdg.h"
+#include "call_graph.h"
+
+#include <csignal>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+enum SessionEnd
+{
+    SESSION_EOF,
+    SESSION_QUIT,
+    SESSION_SHUTDOWN
+};
+
+static bool writeAll(int fd, const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+static std::string getFunctionLabel(Function *function)
+{
+    // 懒加载时未物化的函数还没有挂上 DISubprogram，退回到编译单元的文件名
+    std::string file = function->getParent()->getSourceFileName();
+    if (DISubprogram *subprogram = function->getSubprogram())
+    {
+        file = subprogram->getFilename().str();
+    }
+    else if (!function->getParent()->debug_compile_units().empty())
+    {
+        file = (*function->getParent()->debug_compile_units_begin())->getFilename().str();
+    }
+    return file + ":" + function->getName().str();
+}
+
+// "reach <种子...> [函数名...]"：只用调用图回答，不做数据流分析
+// 没有给出函数名时列出改动可能影响到的全部函数，否则逐个回答 "<函数名> yes|no"
+static bool answerReachQuery(IA &ia, const std::string &query, std::string &response)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    std::string tokens = query;
+    std::replace(tokens.begin(), tokens.end(), ',', ' ');
+    std::istringstream tokenStream(tokens);
+    std::string token;
+    std::vector<std::string> functionNames;
+    tokenStream >> token; // "reach"
+    while (tokenStream >> token)
+    {
+        if (token.find(':') == std::string::npos)
+        {
+            functionNames.push_back(token);
+        }
+        else if (!ia.parseFileInstNo(token))
+        {
+            response = "ERROR file:inst_no format error: " + token + "\n";
+            return false;
+        }
+    }
+    ia.compareChanges();
+    if (ia.getChangedInstructions().empty())
+    {
+        response = "ERROR no instruction at " + query + "\n";
+        return false;
+    }
+
+    CallGraphIndex *callGraph = ia.getCallGraph();
+    std::set<unsigned> seedFunctions;
+    for (auto *inst : ia.getChangedInstructions())
+    {
+        seedFunctions.insert(ia.getFunctionId(inst->getFunction()));
+    }
+    std::vector<std::string> results;
+    if (functionNames.empty())
+    {
+        std::vector<char> visited(callGraph->getSCCCount(), 0);
+        std::set<std::string> labels;
+        for (unsigned seed : seedFunctions)
+        {
+            unsigned scc = callGraph->getSCC(seed);
+            if (scc == CallGraphIndex::noSCC)
+            {
+                labels.insert(getFunctionLabel(ia.getFunctionById(seed)));
+                continue;
+            }
+            for (unsigned reached : callGraph->markReachable(scc, visited))
+            {
+                auto reachedMembers = callGraph->getSCCMembers(reached);
+                for (const unsigned *member = reachedMembers.first; member != reachedMembers.second; member++)
+                {
+                    if (Function *function = ia.getFunctionById(*member))
+                    {
+                        labels.insert(getFunctionLabel(function));
+                    }
+                }
+            }
+        }
+        results.assign(labels.begin(), labels.end());
+    }
+    for (auto &name : functionNames)
+    {
+        bool reached = false;
+        for (auto &module : ia.getModules())
+        {
+            Function *function = module->getFunction(name);
+            if (!function || function->isDeclaration())
+            {
+                continue;
+            }
+            unsigned target = ia.getFunctionId(function);
+            for (unsigned seed : seedFunctions)
+            {
+                reached = reached || callGraph->reaches(seed, target);
+            }
+        }
+        results.push_back(name + (reached ? " yes" : " no"));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+
+    response.clear();
+    for (auto &result : results)
+    {
+        response += result + "\n";
+    }
+    response += "END " + std::to_string(results.size()) + " " + std::to_string(elapsed.count()) + "\n";
+    return true;
+}
+
+bool answerQuery(IA &ia, const std::string &query, std::string &response)
+{
+    ia.resetQuery();
+    if (query.compare(0, 6, "reach ") == 0)
+    {
+        return answerReachQuery(ia, query, response);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    // 一条查询可以包含多个以空白或逗号分隔的种子，返回它们结果的并集
+    std::string seeds = query;
+    std::replace(seeds.begin(), seeds.end(), ',', ' ');
+    std::istringstream seedStream(seeds);
+    std::string seed;
+    while (seedStream >> seed)
+    {
+        if (!ia.parseFileInstNo(seed))
+        {
+            response = "ERROR file:inst_no format error: " + seed + "\n";
+            return false;
+        }
+    }
+    ia.compareChanges();
+    if (ia.getChangedInstructions().empty())
+    {
+        response = "ERROR no instruction at " + query + "\n";
+        return false;
+    }
+    checkChanges(ia);
+
+    std::set<std::string> results;
+    for (auto &impact : ia.getImpacts())
+    {
+        impact.collectFinalResult(results);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+
+    response.clear();
+    for (auto &result : results)
+    {
+        response += result + "\n";
+    }
+    response += "END " + std::to_string(results.size()) + " " + std::to_string(elapsed.count()) + "\n";
+    return true;
+}
+
+static int openWatch(IA &ia)
+{
+    if (!ia.isWatchMode())
+    {
+        return -1;
+    }
+    int watchFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0 || ::inotify_add_watch(watchFd, ia.getCommitBCDir().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+    {
+        errs() << "Error: cannot watch " << ia.getCommitBCDir() << ": " << strerror(errno) << "\n";
+        exit(1);
+    }
+    std::cout << "Watching " << ia.getCommitBCDir() << std::endl;
+    return watchFd;
+}
+
+// 读出所有 inotify 事件并重新加载变化的 .bc 文件
+static void handleWatchEvents(IA &ia, int watchFd)
+{
+    std::set<std::string> changedPaths;
+    alignas(struct inotify_event) char events[16384];
+    while (true)
+    {
+        ssize_t n;
+        while ((n = ::read(watchFd, events, sizeof(events))) > 0)
+        {
+            for (char *p = events; p < events + n;)
+            {
+                auto *event = reinterpret_cast<struct inotify_event *>(p);
+                std::string name = event->len ? event->name : "";
+                if (name.find(".bc") != std::string::npos)
+                {
+                    changedPaths.insert(ia.getCommitBCDir() + "/" + name);
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        // 构建脚本通常会连续写出多个文件，稍等片刻把它们合并为一次重新加载
+        struct pollfd pfd = {watchFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0)
+        {
+            break;
+        }
+    }
+    if (!changedPaths.empty())
+    {
+        ia.reloadModules(std::vector<std::string>(changedPaths.begin(), changedPaths.end()));
+    }
+}
+
+// 等待 fd 可读，期间处理监视目录的变化
+static bool waitReadable(IA &ia, int fd, int watchFd)
+{
+    while (true)
+    {
+        struct pollfd pfds[2] = {{fd, POLLIN, 0}, {watchFd, POLLIN, 0}};
+        int ready = ::poll(pfds, watchFd < 0 ? 1 : 2, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        if (watchFd >= 0 && (pfds[1].revents & POLLIN))
+        {
+            handleWatchEvents(ia, watchFd);
+        }
+        if (pfds[0].revents)
+        {
+            return true;
+        }
+    }
+}
+
+static SessionEnd serveSession(IA &ia, int inFd, int outFd, int watchFd)
+{
+    std::string buffer;
+    char chunk[4096];
+    while (true)
+    {
+        std::string::size_type newline = buffer.find('\n');
+        if (newline == std::string::npos)
+        {
+            if (!waitReadable(ia, inFd, watchFd))
+            {
+                return SESSION_EOF;
+            }
+            ssize_t n = ::read(inFd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return SESSION_EOF;
+            }
+            buffer.append(chunk, n);
+            continue;
+        }
+        std::string query = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+        while (!query.empty() && (query.back() == '\r' || query.back() == ' '))
+        {
+            query.pop_back();
+        }
+        if (query.empty())
+        {
+            continue;
+        }
+        if (query == "quit")
+        {
+            return SESSION_QUIT;
+        }
+        if (query == "shutdown")
+        {
+            return SESSION_SHUTDOWN;
+        }
+
+        std::string response;
+        answerQuery(ia, query, response);
+        ia.resetQuery();
+        ia.trimMaterializedFunctions();
+        if (!writeAll(outFd, response))
+        {
+            return SESSION_EOF;
+        }
+    }
+}
+
+static void serveSocket(IA &ia, const std::string &path, int watchFd)
+{
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+    {
+        errs() << "Error: cannot create socket: " << strerror(errno) << "\n";
+        exit(1);
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        errs() << "Error: socket path too long: " << path << "\n";
+        exit(1);
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(path.c_str());
+    if (::bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listenFd, 8) < 0)
+    {
+        errs() << "Error: cannot listen on " << path << ": " << strerror(errno) << "\n";
+        exit(1);
+    }
+    std::cout << "Listening on " << path << std::endl;
+
+    // 客户端依次处理，索引不需要加锁
+    while (true)
+    {
+        if (!waitReadable(ia, listenFd, watchFd))
+        {
+            errs() << "Error: poll failed: " << strerror(errno) << "\n";
+            break;
+        }
+        int clientFd = ::accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            errs() << "Error: accept failed: " << strerror(errno) << "\n";
+            break;
+        }
+        SessionEnd sessionEnd = serveSession(ia, clientFd, clientFd, watchFd);
+        ::close(clientFd);
+        if (sessionEnd == SESSION_SHUTDOWN)
+        {
+            break;
+        }
+    }
+    ::close(listenFd);
+    ::unlink(path.c_str());
+}
+
+void serveQueries(IA &ia)
+{
+    // 客户端提前断开时不要被 SIGPIPE 结束进程
+    signal(SIGPIPE, SIG_IGN);
+    int watchFd = openWatch(ia);
+    std::string socketPath = ia.getServeSocket();
+    if (!socketPath.empty())
+    {
+        serveSocket(ia, socketPath, watchFd);
+    }
+    else
+    {
+        std::cerr << "Ready" << std::endl;
+        serveSession(ia, STDIN_FILENO, STDOUT_FILENO, watchFd);
+    }
+    if (watchFd >= 0)
+    {
+        ::close(watchFd);
+    }
+}
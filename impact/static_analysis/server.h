@@ -0,0 +1,15 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "module_parse.h"
+
+// 常驻模式：模块与索引只构建一次，之后逐条回答 "file:line" 查询
+// 一条查询可以包含多个种子（空白或逗号分隔），返回结果的并集
+// 每条查询的结果为若干行 "file:func:line"，以 "END <count> <seconds>" 结束
+// "reach <种子...> [函数名...]" 只查询调用图：列出改动可能影响到的函数 "file:func"，或对每个函数名回答 "<函数名> yes|no"
+// 出错时返回 "ERROR <message>"，输入 "quit" 结束当前会话，"shutdown" 结束服务
+// 监视模式下在两次查询之间用 inotify 检查 bcoutput 目录，只重新加载变化的 .bc 文件
+void serveQueries(IA &ia);
+bool answerQuery(IA &ia, const std::string &query, std::string &response);
+
+#endif
@@ -0,0 +1,92 @@
+source_filename = "a.c"
+target triple = "x86_64-pc-linux-gnu"
+
+%struct.S = type { i32, i32 }
+@S = dso_local global %struct.S zeroinitializer
+@count = dso_local global i32 0
+@p = dso_local global %struct.S* null
+
+declare i32 @leaf(i32)
+
+define dso_local i32 @step(i32 %x) !dbg !10 {
+entry:
+  %c = icmp sgt i32 %x, 0, !dbg !11
+  br i1 %c, label %then, label %else, !dbg !11
+then:
+  store %struct.S* @S, %struct.S** @p, !dbg !12
+  store i32 %x, i32* getelementptr (%struct.S, %struct.S* @S, i32 0, i32 1), !dbg !12
+  br label %join, !dbg !12
+else:
+  br label %loop, !dbg !13
+loop:
+  %i = phi i32 [ 0, %else ], [ %n, %body ], !dbg !14
+  %lc = icmp slt i32 %i, %x, !dbg !14
+  br i1 %lc, label %body, label %join, !dbg !14
+body:
+  %n = add i32 %i, 1, !dbg !15
+  store i32 %n, i32* @count, !dbg !15
+  br label %loop, !dbg !15
+join:
+  switch i32 %x, label %done [ i32 1, label %one
+                               i32 2, label %two ], !dbg !16
+one:
+  %r1 = call i32 @leaf(i32 %x), !dbg !17
+  br label %two, !dbg !17
+two:
+  %r2 = call i32 @odd(i32 %x), !dbg !18
+  br label %done, !dbg !18
+done:
+  ret i32 0, !dbg !19
+}
+
+define dso_local i32 @even(i32 %x) !dbg !30 {
+entry:
+  %z = icmp eq i32 %x, 0, !dbg !31
+  br i1 %z, label %yes, label %no, !dbg !31
+yes:
+  ret i32 1, !dbg !32
+no:
+  %m = sub i32 %x, 1, !dbg !33
+  %r = call i32 @odd(i32 %m), !dbg !33
+  ret i32 %r, !dbg !34
+}
+
+define dso_local i32 @odd(i32 %x) !dbg !40 {
+entry:
+  %z = icmp eq i32 %x, 0, !dbg !41
+  br i1 %z, label %yes, label %no, !dbg !41
+yes:
+  ret i32 0, !dbg !42
+no:
+  %m = sub i32 %x, 1, !dbg !43
+  %r = call i32 @even(i32 %m), !dbg !43
+  ret i32 %r, !dbg !44
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "a.c", directory: "/fixture")
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !{i32 7, !"Dwarf Version", i32 4}
+!5 = !DISubroutineType(types: !{})
+!10 = distinct !DISubprogram(name: "step", scope: !1, file: !1, line: 1, type: !5, unit: !0)
+!11 = !DILocation(line: 2, scope: !10)
+!12 = !DILocation(line: 3, scope: !10)
+!13 = !DILocation(line: 4, scope: !10)
+!14 = !DILocation(line: 5, scope: !10)
+!15 = !DILocation(line: 6, scope: !10)
+!16 = !DILocation(line: 7, scope: !10)
+!17 = !DILocation(line: 8, scope: !10)
+!18 = !DILocation(line: 9, scope: !10)
+!19 = !DILocation(line: 10, scope: !10)
+!30 = distinct !DISubprogram(name: "even", scope: !1, file: !1, line: 12, type: !5, unit: !0)
+!31 = !DILocation(line: 13, scope: !30)
+!32 = !DILocation(line: 14, scope: !30)
+!33 = !DILocation(line: 15, scope: !30)
+!34 = !DILocation(line: 16, scope: !30)
+!40 = distinct !DISubprogram(name: "odd", scope: !1, file: !1, line: 18, type: !5, unit: !0)
+!41 = !DILocation(line: 19, scope: !40)
+!42 = !DILocation(line: 20, scope: !40)
+!43 = !DILocation(line: 21, scope: !40)
+!44 = !DILocation(line: 22, scope: !40)
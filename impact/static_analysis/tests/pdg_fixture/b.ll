@@ -0,0 +1,38 @@
+source_filename = "b.c"
+target triple = "x86_64-pc-linux-gnu"
+
+%struct.S = type { i32, i32 }
+@S = external global %struct.S
+@count = external global i32
+
+declare i32 @step(i32)
+
+define dso_local i32 @leaf(i32 %x) !dbg !10 {
+entry:
+  %v = load i32, i32* getelementptr (%struct.S, %struct.S* @S, i32 0, i32 1), !dbg !11
+  %w = add i32 %v, %x, !dbg !12
+  ret i32 %w, !dbg !13
+}
+
+define dso_local i32 @reader() !dbg !20 {
+entry:
+  %v = load i32, i32* @count, !dbg !21
+  %r = call i32 @step(i32 %v), !dbg !22
+  ret i32 %r, !dbg !23
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "b.c", directory: "/fixture")
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !{i32 7, !"Dwarf Version", i32 4}
+!5 = !DISubroutineType(types: !{})
+!10 = distinct !DISubprogram(name: "leaf", scope: !1, file: !1, line: 1, type: !5, unit: !0)
+!11 = !DILocation(line: 2, scope: !10)
+!12 = !DILocation(line: 3, scope: !10)
+!13 = !DILocation(line: 4, scope: !10)
+!20 = distinct !DISubprogram(name: "reader", scope: !1, file: !1, line: 6, type: !5, unit: !0)
+!21 = !DILocation(line: 7, scope: !20)
+!22 = !DILocation(line: 8, scope: !20)
+!23 = !DILocation(line: 9, scope: !20)